@@ -39,11 +39,9 @@ inline static const char *buf_str(Buf buf) {
     return buf->head;
 }
 
-inline static void buf_append_string(Buf buf, const char *s, size_t slen) {
-    if (0 == slen) {
-        return;
-    }
-
+// Makes room for slen more bytes so they can be written at buf->tail
+// directly.
+inline static void buf_reserve(Buf buf, size_t slen) {
     if (buf->end <= buf->tail + slen) {
         size_t len     = buf->end - buf->head;
         size_t toff    = buf->tail - buf->head;
@@ -58,6 +56,13 @@ inline static void buf_append_string(Buf buf, const char *s, size_t slen) {
         buf->tail = buf->head + toff;
         buf->end  = buf->head + new_len - 1;
     }
+}
+
+inline static void buf_append_string(Buf buf, const char *s, size_t slen) {
+    if (0 == slen) {
+        return;
+    }
+    buf_reserve(buf, slen);
     memcpy(buf->tail, s, slen);
     buf->tail += slen;
 }
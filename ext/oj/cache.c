@@ -13,7 +13,10 @@
 // ALLOC_N, REALLOC, and xfree since the later could trigger a GC which will
 // either corrupt memory or if the mark function locks will deadlock.
 
-#define REHASH_LIMIT 4
+// The table is open addressed with linear probing. Each bucket holds the
+// full hash of its key next to the slot so a probe only reads the slot of a
+// bucket whose hash matches. Four buckets fit in a cache line and the table
+// is kept at most half full so most probes end in the first line.
 #define MIN_SHIFT 8
 #define REUSE_MAX 8192
 
@@ -25,8 +28,29 @@
 #define CACHE_UNLOCK(c) rb_mutex_unlock((c)->mutex)
 #endif
 
-// almost the Murmur hash algorithm
-#define M 0x5bd1e995
+// The locking cache is shared by threads. Lookups that find the key do not
+// take the lock. New slots are added under the lock and published to their
+// bucket with a release store after the slot and the bucket hash are filled
+// in so a reader that sees a slot sees all of it. A rehash builds a new
+// table and publishes it before the mask that covers it. Buckets are only
+// emptied, and replaced tables only freed, in cache_mark() while the GC has
+// every thread stopped so no lookup can be part way through a probe.
+#if defined(__GNUC__) || defined(__clang__)
+#define LOCK_FREE_READS 1
+#define LOAD_ACQ(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE_REL(ptr, v) __atomic_store_n(ptr, v, __ATOMIC_RELEASE)
+#else
+#define LOCK_FREE_READS 0
+#define LOAD_ACQ(ptr) (*(ptr))
+#define STORE_REL(ptr, v) (*(ptr) = (v))
+#endif
+
+// A slot's use count stops being bumped once it reaches USE_MAX so a hot
+// key is not written to by every thread that reads it.
+#define USE_MAX 0x00010000
+
+#define M1 0x9E3779B97F4A7C15ULL
+#define M2 0xD6E8FEB86659FD93ULL
 
 uint64_t oj_hash_seed = 0;
 
@@ -45,7 +69,7 @@ void oj_hash_seed_init(void) {
 }
 
 typedef struct _slot {
-    struct _slot     *next;
+    struct _slot     *next;  // only used on the reuse list
     VALUE             val;
     uint64_t          hash;
     volatile uint32_t use_cnt;
@@ -53,15 +77,28 @@ typedef struct _slot {
     char              key[CACHE_MAX_KEY];
 } *Slot;
 
+typedef struct _bucket {
+    uint64_t      hash;
+    Slot volatile slot;  // NULL if empty
+} *Bucket;
+
+// A table replaced by a rehash of a locking cache is kept until the next
+// cache_mark() since a reader may still be looking at it.
+typedef struct _retired {
+    struct _retired *next;
+    Bucket           buckets;
+} *Retired;
+
 typedef struct _cache {
-    volatile Slot  *slots;
+    Bucket volatile buckets;
     volatile size_t cnt;
     VALUE (*form)(const char *str, size_t len);
-    uint64_t size;
-    uint64_t mask;
+    uint64_t          size;
+    volatile uint64_t mask;
     VALUE (*intern)(struct _cache *c, const char *key, size_t len);
     volatile Slot reuse;
     size_t        rcnt;
+    Retired       retired;
 #if HAVE_PTHREAD_MUTEX_INIT
     pthread_mutex_t mutex;
 #else
@@ -75,72 +112,115 @@ void cache_set_form(Cache c, VALUE (*form)(const char *str, size_t len)) {
     c->form = form;
 }
 
+static inline uint64_t load64(const uint8_t *p) {
+    uint64_t k;
+
+    memcpy(&k, p, sizeof(k));
+
+    return k;
+}
+
+// Keys are read eight bytes at a time. The last eight bytes of a key of
+// eight or more are read from the end so no byte past the key is read and
+// shorter keys are put together from a four byte and a one to four byte
+// read.
 static uint64_t hash_calc(const uint8_t *key, size_t len) {
-    const uint8_t *end     = key + len;
-    const uint8_t *endless = key + (len & 0xFFFFFFFC);
-    uint64_t       h       = (uint64_t)len ^ oj_hash_seed;
+    const uint8_t *end = key + len;
+    uint64_t       h   = ((uint64_t)len * M1) ^ oj_hash_seed;
     uint64_t       k;
 
-    while (key < endless) {
-        k = (uint64_t)*key++;
-        k |= (uint64_t)*key++ << 8;
-        k |= (uint64_t)*key++ << 16;
-        k |= (uint64_t)*key++ << 24;
+    if (8 <= len) {
+        for (; key + 8 < end; key += 8) {
+            h = (h ^ load64(key)) * M2;
+            h ^= h >> 29;
+        }
+        k = load64(end - 8);
+    } else if (4 <= len) {
+        uint32_t lo;
+        uint32_t hi;
+
+        memcpy(&lo, key, sizeof(lo));
+        memcpy(&hi, end - 4, sizeof(hi));
+        k = ((uint64_t)hi << 32) | lo;
+    } else if (0 < len) {
+        k = ((uint64_t)key[0] << 16) | ((uint64_t)key[len / 2] << 8) | end[-1];
+    } else {
+        k = 0;
+    }
+    h = (h ^ k) * M2;
+    h ^= h >> 32;
+    h *= M1;
+    h ^= h >> 29;
+
+    return h;
+}
+
+// Called only by the thread holding the lock, or the only thread for a
+// lockless cache.
+static void bucket_add(Bucket buckets, uint64_t mask, Slot s) {
+    uint64_t i = s->hash & mask;
 
-        k *= M;
-        k ^= k >> 24;
-        h *= M;
-        h ^= k * M;
+    while (NULL != buckets[i].slot) {
+        i = (i + 1) & mask;
     }
-    if (1 < end - key) {
-        uint16_t k16 = (uint16_t)*key++;
+    buckets[i].hash = s->hash;
+    STORE_REL(&buckets[i].slot, s);
+}
 
-        k16 |= (uint16_t)*key++ << 8;
-        h ^= k16 << 8;
+static VALUE locking_intern(Cache c, const char *key, size_t len);
+
+static void rehash(Cache c) {
+    uint64_t size    = c->size * 4;
+    Bucket   old     = c->buckets;
+    Bucket   end     = old + c->size;
+    Bucket   buckets = OJ_CALLOC(size, sizeof(struct _bucket));
+    Bucket   b;
+
+    for (b = old; b < end; b++) {
+        if (NULL != b->slot) {
+            bucket_add(buckets, size - 1, b->slot);
+        }
     }
-    if (key < end) {
-        h ^= *key;
+    STORE_REL(&c->buckets, buckets);
+    c->size = size;
+    STORE_REL(&c->mask, size - 1);
+    if (locking_intern == c->intern) {
+        Retired r = OJ_MALLOC(sizeof(struct _retired));
+
+        r->buckets = old;
+        r->next    = c->retired;
+        c->retired = r;
+    } else {
+        OJ_FREE(old);
     }
-    h *= M;
-    h ^= h >> 13;
-    h *= M;
-    h ^= h >> 15;
-
-    return h;
 }
 
-static void rehash(Cache c) {
-    uint64_t osize;
-    Slot    *end;
-    Slot    *sp;
-
-    osize    = c->size;
-    c->size  = osize * 4;
-    c->mask  = c->size - 1;
-    c->slots = OJ_REALLOC((void *)c->slots, sizeof(Slot) * c->size);
-    memset((Slot *)c->slots + osize, 0, sizeof(Slot) * osize * 3);
-    end = (Slot *)c->slots + osize;
-    for (sp = (Slot *)c->slots; sp < end; sp++) {
-        Slot s    = *sp;
-        Slot next = NULL;
-
-        *sp = NULL;
-        for (; NULL != s; s = next) {
-            uint64_t h      = s->hash & c->mask;
-            Slot    *bucket = (Slot *)c->slots + h;
-
-            next    = s->next;
-            s->next = *bucket;
-            *bucket = s;
+static Slot find(Cache c, uint64_t h, const char *key, size_t len) {
+    // The mask is loaded before the table so it is never larger than the
+    // table. Tables only grow but a probe with an old mask on a new table
+    // could in theory go around forever so it is bounded.
+    uint64_t mask    = LOAD_ACQ(&c->mask);
+    Bucket   buckets = LOAD_ACQ(&c->buckets);
+    uint64_t i       = h & mask;
+    uint64_t n;
+    Slot     s;
+
+    for (n = 0; n <= mask; n++, i = (i + 1) & mask) {
+        if (NULL == (s = LOAD_ACQ(&buckets[i].slot))) {
+            break;
+        }
+        if (h == buckets[i].hash && (uint8_t)len == s->klen && 0 == memcmp(s->key, key, len)) {
+            if (s->use_cnt < USE_MAX) {
+                s->use_cnt += 4;
+            }
+            return s;
         }
     }
+    return NULL;
 }
 
-static VALUE lockless_intern(Cache c, const char *key, size_t len) {
-    uint64_t       h      = hash_calc((const uint8_t *)key, len);
-    Slot          *bucket = (Slot *)c->slots + (h & c->mask);
-    Slot           b;
-    volatile VALUE rkey;
+static void reuse_trim(Cache c) {
+    Slot b;
 
     while (REUSE_MAX < c->rcnt) {
         if (NULL != (b = c->reuse)) {
@@ -152,11 +232,25 @@ static VALUE lockless_intern(Cache c, const char *key, size_t len) {
             c->rcnt = 0;
         }
     }
-    for (b = *bucket; NULL != b; b = b->next) {
-        if ((uint8_t)len == b->klen && 0 == strncmp(b->key, key, len)) {
-            b->use_cnt += 16;
-            return b->val;
-        }
+}
+
+static void slot_set(Slot b, uint64_t h, const char *key, size_t len, VALUE val, uint32_t use_cnt) {
+    b->hash = h;
+    memcpy(b->key, key, len);
+    b->klen     = (uint8_t)len;
+    b->key[len] = '\0';
+    b->val      = val;
+    b->use_cnt  = use_cnt;
+}
+
+static VALUE lockless_intern(Cache c, const char *key, size_t len) {
+    uint64_t       h = hash_calc((const uint8_t *)key, len);
+    Slot           b;
+    volatile VALUE rkey;
+
+    reuse_trim(c);
+    if (NULL != (b = find(c, h, key, len))) {
+        return b->val;
     }
     rkey = c->form(key, len);
     if (NULL == (b = c->reuse)) {
@@ -165,50 +259,33 @@ static VALUE lockless_intern(Cache c, const char *key, size_t len) {
         c->reuse = b->next;
         c->rcnt--;
     }
-    b->hash = h;
-    memcpy(b->key, key, len);
-    b->klen     = (uint8_t)len;
-    b->key[len] = '\0';
-    b->val      = rkey;
-    b->use_cnt  = 4;
-    b->next     = *bucket;
-    *bucket     = b;
-    c->cnt++;  // Don't worry about wrapping. Worse case is the entry is removed and recreated.
-    if (REHASH_LIMIT < c->cnt / c->size) {
+    slot_set(b, h, key, len, rkey, 4);
+    if (c->size < (c->cnt + 1) * 2) {
         rehash(c);
     }
+    bucket_add(c->buckets, c->mask, b);
+    c->cnt++;
+
     return rkey;
 }
 
 static VALUE locking_intern(Cache c, const char *key, size_t len) {
-    uint64_t       h;
-    Slot          *bucket;
+    uint64_t       h = hash_calc((const uint8_t *)key, len);
     Slot           b;
-    uint64_t       old_size;
     volatile VALUE rkey;
 
-    CACHE_LOCK(c);
-    while (REUSE_MAX < c->rcnt) {
-        if (NULL != (b = c->reuse)) {
-            c->reuse = b->next;
-            OJ_FREE(b);
-            c->rcnt--;
-        } else {
-            // An accounting error occured somewhere so correct it.
-            c->rcnt = 0;
-        }
+#if LOCK_FREE_READS
+    if (NULL != (b = find(c, h, key, len))) {
+        return b->val;
     }
-    h      = hash_calc((const uint8_t *)key, len);
-    bucket = (Slot *)c->slots + (h & c->mask);
-    for (b = *bucket; NULL != b; b = b->next) {
-        if ((uint8_t)len == b->klen && 0 == strncmp(b->key, key, len)) {
-            b->use_cnt += 4;
-            CACHE_UNLOCK(c);
-
-            return b->val;
-        }
+#endif
+    CACHE_LOCK(c);
+    reuse_trim(c);
+    if (NULL != (b = find(c, h, key, len))) {
+        CACHE_UNLOCK(c);
+
+        return b->val;
     }
-    old_size = c->size;
     // The creation of a new value may trigger a GC which be a problem if the
     // cache is locked so make sure it is unlocked for the key value creation.
     if (NULL != (b = c->reuse)) {
@@ -219,26 +296,18 @@ static VALUE locking_intern(Cache c, const char *key, size_t len) {
     if (NULL == b) {
         b = OJ_CALLOC(1, sizeof(struct _slot));
     }
-    rkey    = c->form(key, len);
-    b->hash = h;
-    memcpy(b->key, key, len);
-    b->klen     = (uint8_t)len;
-    b->key[len] = '\0';
-    b->val      = rkey;
-    b->use_cnt  = 16;
+    rkey = c->form(key, len);
+    slot_set(b, h, key, len, rkey, 16);
 
-    // Lock again to add the new entry.
+    // Lock again to add the new entry. Another thread may have added the
+    // same key while the lock was released. Both slots then work for lookups
+    // and the unused one is expunged in time.
     CACHE_LOCK(c);
-    if (old_size != c->size) {
-        h      = hash_calc((const uint8_t *)key, len);
-        bucket = (Slot *)c->slots + (h & c->mask);
-    }
-    b->next = *bucket;
-    *bucket = b;
-    c->cnt++;  // Don't worry about wrapping. Worse case is the entry is removed and recreated.
-    if (REHASH_LIMIT < c->cnt / c->size) {
+    if (c->size < (c->cnt + 1) * 2) {
         rehash(c);
     }
+    bucket_add(c->buckets, c->mask, b);
+    c->cnt++;
     CACHE_UNLOCK(c);
 
     return rkey;
@@ -246,9 +315,9 @@ static VALUE locking_intern(Cache c, const char *key, size_t len) {
 
 Cache cache_create(size_t size, VALUE (*form)(const char *str, size_t len), bool mark, bool locking) {
     Cache c     = OJ_CALLOC(1, sizeof(struct _cache));
-    int   shift = 0;
+    int   shift = 1;
 
-    for (; REHASH_LIMIT < size; size /= 2, shift++) {
+    for (; 0 < size; size /= 2, shift++) {
     }
     if (shift < MIN_SHIFT) {
         shift = MIN_SHIFT;
@@ -258,12 +327,12 @@ Cache cache_create(size_t size, VALUE (*form)(const char *str, size_t len), bool
 #else
     c->mutex = rb_mutex_new();
 #endif
-    c->size  = 1 << shift;
-    c->mask  = c->size - 1;
-    c->slots = OJ_CALLOC(c->size, sizeof(Slot));
-    c->form  = form;
-    c->xrate = 1;  // low
-    c->mark  = mark;
+    c->size    = (uint64_t)1 << shift;
+    c->mask    = c->size - 1;
+    c->buckets = OJ_CALLOC(c->size, sizeof(struct _bucket));
+    c->form    = form;
+    c->xrate   = 1;  // low
+    c->mark    = mark;
     if (locking) {
         c->intern = locking_intern;
     } else {
@@ -276,23 +345,62 @@ void cache_set_expunge_rate(Cache c, int rate) {
     c->xrate = (uint8_t)rate;
 }
 
+static void retired_free(Cache c) {
+    while (NULL != c->retired) {
+        Retired r = c->retired;
+
+        c->retired = r->next;
+        OJ_FREE(r->buckets);
+        OJ_FREE(r);
+    }
+}
+
 void cache_free(void *data) {
     Cache    c = (Cache)data;
     uint64_t i;
 
     for (i = 0; i < c->size; i++) {
-        Slot next;
-        Slot s;
-
-        for (s = c->slots[i]; NULL != s; s = next) {
-            next = s->next;
-            OJ_FREE(s);
+        if (NULL != c->buckets[i].slot) {
+            OJ_FREE(c->buckets[i].slot);
         }
     }
-    OJ_FREE((void *)c->slots);
+    while (NULL != c->reuse) {
+        Slot s = c->reuse;
+
+        c->reuse = s->next;
+        OJ_FREE(s);
+    }
+    retired_free(c);
+    OJ_FREE(c->buckets);
     OJ_FREE(c);
 }
 
+// Empties bucket i by moving back any later bucket of the same probe run
+// that would no longer be found past the hole.
+static void bucket_remove(Cache c, uint64_t i) {
+    Bucket   buckets = c->buckets;
+    uint64_t mask    = c->mask;
+    uint64_t j       = i;
+
+    while (true) {
+        uint64_t k;
+
+        j = (j + 1) & mask;
+        if (NULL == buckets[j].slot) {
+            break;
+        }
+        k = buckets[j].hash & mask;
+        // Leave j where it is if its home k is cyclically in (i, j].
+        if ((i < j) ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue;
+        }
+        buckets[i] = buckets[j];
+        i          = j;
+    }
+    buckets[i].slot = NULL;
+    buckets[i].hash = 0;
+}
+
 void cache_mark(void *data) {
     Cache    c = (Cache)data;
     uint64_t i;
@@ -300,39 +408,38 @@ void cache_mark(void *data) {
 #if !HAVE_PTHREAD_MUTEX_INIT
     rb_gc_mark(c->mutex);
 #endif
+    retired_free(c);
     if (0 == c->cnt) {
         return;
     }
-    for (i = 0; i < c->size; i++) {
-        Slot s;
-        Slot prev = NULL;
-        Slot next;
-
-        for (s = c->slots[i]; NULL != s; s = next) {
-            next = s->next;
-            if (0 == s->use_cnt) {
-                if (NULL == prev) {
-                    c->slots[i] = next;
-                } else {
-                    prev->next = next;
-                }
-                c->cnt--;
-                s->next  = c->reuse;
-                c->reuse = s;
-                c->rcnt++;
-                continue;
-            }
-            switch (c->xrate) {
-            case 0: break;
-            case 2: s->use_cnt -= 2; break;
-            case 3: s->use_cnt /= 2; break;
-            default: s->use_cnt--; break;
-            }
-            if (c->mark) {
-                rb_gc_mark(s->val);
-            }
-            prev = s;
+    for (i = 0; i < c->size;) {
+        Slot s = c->buckets[i].slot;
+
+        if (NULL == s) {
+            i++;
+            continue;
+        }
+        if (0 == s->use_cnt) {
+            // A bucket moved back into i is looked at next. One that wraps
+            // around from the front of the table may be looked at twice
+            // which only ages it one more time.
+            bucket_remove(c, i);
+            c->cnt--;
+            s->next  = c->reuse;
+            c->reuse = s;
+            c->rcnt++;
+            continue;
+        }
+        switch (c->xrate) {
+        case 0: break;
+        case 2: s->use_cnt -= 2; break;
+        case 3: s->use_cnt /= 2; break;
+        default: s->use_cnt--; break;
+        }
+        if (c->mark) {
+            rb_gc_mark(s->val);
         }
+        i++;
     }
 }
 
@@ -240,6 +240,95 @@ void OJ_TARGET_SSE42 initialize_sse42(void) {
 
 #endif /* HAVE_SIMD_SSE4_2 */
 
+#ifdef HAVE_SIMD_AVX2
+// The JSON standard escapes are regular enough to count from compare masks
+// instead of a table lookup per byte. A quote, backslash, or (when escaping
+// them) forward slash adds one byte as do the \b, \t, \n, \f, and \r control
+// characters. Any other control character becomes a six byte \u00XX. The
+// table is only used for the tail.
+static OJ_TARGET_AVX2 size_t json_friendly_size_avx2(const uint8_t *str, size_t len, bool slash, const char *table) {
+    const uint8_t *end       = str + len;
+    const __m256i  ctrl_max  = _mm256_set1_epi8(0x1F);
+    const __m256i  short_min = _mm256_set1_epi8('\b');
+    const __m256i  short_max = _mm256_set1_epi8('\r');
+    const __m256i  vtab      = _mm256_set1_epi8('\v');
+    const __m256i  quote     = _mm256_set1_epi8('"');
+    const __m256i  backslash = _mm256_set1_epi8('\\');
+    const __m256i  solidus   = _mm256_set1_epi8(slash ? '/' : '"');
+    size_t         size      = len - len % sizeof(__m256i);  // the table counts the tail
+
+    for (; str + sizeof(__m256i) <= end; str += sizeof(__m256i)) {
+        const __m256i  chunk = _mm256_loadu_si256((const __m256i *)str);
+        const __m256i  ctrl  = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, ctrl_max), chunk);
+        const __m256i  two   = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                                             _mm256_cmpeq_epi8(chunk, backslash)),
+                                             _mm256_cmpeq_epi8(chunk, solidus));
+        const uint32_t cm    = (uint32_t)_mm256_movemask_epi8(ctrl);
+        const uint32_t tm    = (uint32_t)_mm256_movemask_epi8(two);
+
+        if (OJ_LIKELY(0 == (cm | tm))) {
+            continue;
+        }
+        if (0 != cm) {
+            const __m256i in_range =
+                _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_max_epu8(chunk, short_min), short_max), chunk);
+            const uint32_t sm = (uint32_t)_mm256_movemask_epi8(_mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, vtab),
+                                                                                   in_range));
+
+            size += 5 * OJ_POPCOUNT64(cm) - 4 * OJ_POPCOUNT64(sm);
+        }
+        size += OJ_POPCOUNT64(tm);
+    }
+    return size + calculate_string_size(str, end - str, table);
+}
+#endif
+
+#ifdef HAVE_SIMD_AVX512
+// The AVX-512BW version of json_friendly_size_avx2(). The tail goes through a
+// masked load so every byte is counted with the vector compares.
+static OJ_TARGET_AVX512 size_t json_friendly_size_avx512(const uint8_t *str, size_t len, bool slash) {
+    const uint8_t *end       = str + len;
+    const __m512i  ctrl_max  = _mm512_set1_epi8(0x1F);
+    const __m512i  short_min = _mm512_set1_epi8('\b');
+    const __m512i  short_max = _mm512_set1_epi8('\r');
+    const __m512i  vtab      = _mm512_set1_epi8('\v');
+    const __m512i  quote     = _mm512_set1_epi8('"');
+    const __m512i  backslash = _mm512_set1_epi8('\\');
+    const __m512i  solidus   = _mm512_set1_epi8(slash ? '/' : '"');
+    size_t         size      = len;
+    __mmask64      valid     = ~(__mmask64)0;
+
+    while (str < end) {
+        __m512i   chunk;
+        __mmask64 cm;
+        __mmask64 tm;
+
+        if (str + sizeof(__m512i) <= end) {
+            chunk = _mm512_loadu_si512((const void *)str);
+        } else {
+            valid = (__mmask64)(~0ULL >> (sizeof(__m512i) - (end - str)));
+            chunk = _mm512_maskz_loadu_epi8(valid, (const void *)str);
+        }
+        cm = _mm512_mask_cmple_epu8_mask(valid, chunk, ctrl_max);
+        tm = _mm512_cmpeq_epi8_mask(chunk, quote) | _mm512_cmpeq_epi8_mask(chunk, backslash) |
+             _mm512_cmpeq_epi8_mask(chunk, solidus);
+        if (OJ_UNLIKELY(0 != (cm | tm))) {
+            if (0 != cm) {
+                const __mmask64 sm = _mm512_mask_cmple_epu8_mask(_mm512_cmpge_epu8_mask(chunk, short_min),
+                                                                 chunk,
+                                                                 short_max) &
+                                     ~_mm512_cmpeq_epi8_mask(chunk, vtab);
+
+                size += 5 * OJ_POPCOUNT64(cm) - 4 * OJ_POPCOUNT64(sm);
+            }
+            size += OJ_POPCOUNT64(tm);
+        }
+        str += sizeof(__m512i);
+    }
+    return size;
+}
+#endif
+
 inline static size_t hibit_friendly_size(const uint8_t *str, size_t len) {
 #ifdef HAVE_SIMD_NEON
     size_t size = 0;
@@ -283,7 +372,17 @@ inline static size_t hibit_friendly_size(const uint8_t *str, size_t len) {
 
     return total;
 #elif defined(HAVE_SIMD_SSE4_2)
-    if (SIMD_Impl == SIMD_SSE42) {
+#ifdef HAVE_SIMD_AVX512
+    if (SIMD_AVX512 == SIMD_Impl) {
+        return json_friendly_size_avx512(str, len, false);
+    }
+#endif
+#ifdef HAVE_SIMD_AVX2
+    if (SIMD_AVX2 == SIMD_Impl && len >= sizeof(__m256i)) {
+        return json_friendly_size_avx2(str, len, false, hibit_friendly_chars);
+    }
+#endif
+    if (SIMD_SSE42 <= SIMD_Impl) {
         if (len >= sizeof(__m128i)) {
             return hibit_friendly_size_sse42(str, len);
         }
@@ -295,6 +394,16 @@ inline static size_t hibit_friendly_size(const uint8_t *str, size_t len) {
 }
 
 inline static size_t slash_friendly_size(const uint8_t *str, size_t len) {
+#ifdef HAVE_SIMD_AVX512
+    if (SIMD_AVX512 == SIMD_Impl) {
+        return json_friendly_size_avx512(str, len, true);
+    }
+#endif
+#ifdef HAVE_SIMD_AVX2
+    if (SIMD_AVX2 == SIMD_Impl && len >= sizeof(__m256i)) {
+        return json_friendly_size_avx2(str, len, true, slash_friendly_chars);
+    }
+#endif
     return calculate_string_size(str, len, slash_friendly_chars);
 }
 
@@ -1253,7 +1362,7 @@ void oj_dump_cstr(const char *str, size_t cnt, bool is_sym, bool escape1, Out ou
         bool use_simd = (cmap_neon != NULL && cnt >= (sizeof(uint8x16_t))) ? true : false;
 #elif defined(HAVE_SIMD_SSE4_2)
         bool use_simd = false;
-        if (SIMD_Impl == SIMD_SSE42) {
+        if (SIMD_SSE42 <= SIMD_Impl) {
             use_simd = (cmap_sse42 != NULL && cnt >= (sizeof(__m128i))) ? true : false;
         }
 #endif
@@ -1343,7 +1452,7 @@ void oj_dump_cstr(const char *str, size_t cnt, bool is_sym, bool escape1, Out ou
 #endif
 
 #ifdef HAVE_SIMD_SSE4_2
-        if (SIMD_Impl == SIMD_SSE42) {
+        if (SIMD_SSE42 <= SIMD_Impl) {
             if (use_simd) {
                 while (str < end) {
                     const char *chunk_ptr = NULL;
@@ -30,9 +30,14 @@ have_func('rb_gc_mark_movable')
 have_func('stpcpy')
 have_func('pthread_mutex_init')
 have_func('getrlimit', 'sys/resource.h')
+have_func('mmap', 'sys/mman.h')
+have_func('madvise', 'sys/mman.h')
+have_func('posix_fadvise', 'fcntl.h')
 have_func('rb_enc_interned_str')
 have_func('rb_ext_ractor_safe', 'ruby.h')
 have_func('rb_hash_start', 'ruby.h')
+have_func('rb_hash_new_capa', 'ruby.h')
+have_func('rb_thread_call_without_gvl', 'ruby/thread.h')
 
 dflags['OJ_DEBUG'] = true unless ENV['OJ_DEBUG'].nil?
 
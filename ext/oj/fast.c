@@ -15,6 +15,7 @@
 #include "encode.h"
 #include "mem.h"
 #include "oj.h"
+#include "simd.h"
 
 // maximum to allocate on the stack, arbitrary limit
 #define SMALL_JSON 65536
@@ -49,6 +50,7 @@ typedef struct _doc {
 typedef struct _parseInfo {
     char *str;  // buffer being read from
     char *s;    // current position in buffer
+    char *end;  // the null terminator at the end of the buffer
     Doc   doc;
     void *stack_min;
 } *ParseInfo;
@@ -75,7 +77,7 @@ static char *read_quoted_value(ParseInfo pi);
 static void  skip_comment(ParseInfo pi);
 
 static VALUE protect_open_proc(VALUE x);
-static VALUE parse_json(VALUE clas, char *json, bool given);
+static VALUE parse_json(VALUE clas, char *json, size_t len, bool given);
 static void  each_leaf(Doc doc, VALUE self);
 static int   move_step(Doc doc, const char *path, int loc);
 static Leaf  get_doc_leaf(Doc doc, const char *path);
@@ -89,9 +91,13 @@ inline static void next_non_white(ParseInfo pi) {
         switch (*pi->s) {
         case ' ':
         case '\t':
-        case '\f':
         case '\n':
-        case '\r': break;
+        case '\r':
+            if (' ' >= (unsigned char)pi->s[1]) {
+                pi->s = (char *)oj_skip_white(pi->s, pi->end, NULL, NULL) - 1;
+            }
+            break;
+        case '\f': break;
         case '/':
             skip_comment(pi);
             // A comment that is not terminated by a newline ends on the null
@@ -797,7 +803,7 @@ static const rb_data_type_t oj_doc_type = {
     0,
 };
 
-static VALUE parse_json(VALUE clas, char *json, bool given) {
+static VALUE parse_json(VALUE clas, char *json, size_t len, bool given) {
     struct _parseInfo pi;
     volatile VALUE    result = Qnil;
     Doc               doc;
@@ -812,7 +818,8 @@ static VALUE parse_json(VALUE clas, char *json, bool given) {
     } else {
         pi.str = json;
     }
-    pi.s = pi.str;
+    pi.s   = pi.str;
+    pi.end = json + len;
     doc_init(doc);
     pi.doc = doc;
 #if IS_WINDOWS || !defined(HAVE_GETRLIMIT)
@@ -1147,7 +1154,7 @@ static VALUE doc_open(VALUE clas, VALUE str) {
     json = OJ_R_ALLOC_N(char, len);
 
     memcpy(json, StringValuePtr(str), len);
-    obj = parse_json(clas, json, given);
+    obj = parse_json(clas, json, len - 1, given);
     // json is owned by the doc and freed by doc_free(); do not free it here.
     return obj;
 }
@@ -1199,7 +1206,7 @@ static VALUE doc_open_file(VALUE clas, VALUE filename) {
     }
     fclose(f);
     json[len] = '\0';
-    obj       = parse_json(clas, json, given);
+    obj       = parse_json(clas, json, len, given);
     // json is owned by the doc and freed by doc_free(); do not free it here.
     return obj;
 }
@@ -0,0 +1,21 @@
+// Copyright (c) 2026, Peter Ohler, All rights reserved.
+// Licensed under the MIT License. See LICENSE file in the project root for license details.
+
+#ifndef OJ_FAST_FLOAT_H
+#define OJ_FAST_FLOAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Converts a decimal of mantissa * 10^exp10 to the nearest double using the
+// Clinger fast path or the Eisel-Lemire algorithm. The mantissa must be the
+// exact significant digits of the number. Returns false, leaving d untouched,
+// in the rare cases neither can decide and the caller must fall back to
+// strtod().
+extern bool oj_fast_float(uint64_t mantissa, int64_t exp10, bool neg, double *d);
+
+// Same as oj_fast_float() but falls back to strtod() itself so the result is
+// always the correctly rounded double.
+extern double oj_decimal_to_double(uint64_t mantissa, int64_t exp10, bool neg);
+
+#endif /* OJ_FAST_FLOAT_H */
@@ -175,6 +175,7 @@ VALUE oj_cache_mutex = Qnil;
 SIMD_Implementation SIMD_Impl = SIMD_NONE;
 
 extern void oj_parser_init();
+extern void oj_tape_init();
 
 const char oj_json_class[] = "json_class";
 
@@ -2197,6 +2198,22 @@ SIMD_Implementation oj_get_simd_implementation(void) {
     int cpu_info[4];
     __cpuid(cpu_info, 1);
 
+    // AVX2 needs the OS to save the YMM registers (OSXSAVE, bit 27 of ECX, and
+    // XCR0 bits 1 and 2) as well as the CPU flag (bit 5 of EBX of leaf 7).
+    if ((cpu_info[2] & (1 << 27)) && 6 == (_xgetbv(0) & 6)) {
+        unsigned long long xcr0 = _xgetbv(0);
+        int                ext_info[4];
+
+        __cpuidex(ext_info, 7, 0);
+        // AVX-512 also needs the opmask and ZMM state saved (XCR0 bits 5, 6,
+        // and 7) along with AVX512F (bit 16) and AVX512BW (bit 30).
+        if (0xE6 == (xcr0 & 0xE6) && (ext_info[1] & (1 << 16)) && (ext_info[1] & (1 << 30))) {
+            return SIMD_AVX512;
+        }
+        if (ext_info[1] & (1 << 5)) {
+            return SIMD_AVX2;
+        }
+    }
     // Check for SSE4.2 (bit 20 of ECX)
     if (cpu_info[2] & (1 << 20)) {
         return SIMD_SSE42;
@@ -2218,6 +2235,17 @@ SIMD_Implementation oj_get_simd_implementation(void) {
 #endif
 
 #ifdef OJ_HAS_BUILTIN_CPU_SUPPORTS
+#ifdef HAVE_SIMD_AVX512
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return SIMD_AVX512;
+    }
+#endif
+#ifdef HAVE_SIMD_AVX2
+    // Also checks that the OS saves the YMM registers.
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+#endif
 #ifdef HAVE_SIMD_SSE4_2
     if (__builtin_cpu_supports("sse4.2")) {
         return SIMD_SSE42;
@@ -2564,6 +2592,7 @@ void Init_oj(void) {
     SIMD_Impl = oj_get_simd_implementation();
 
     oj_parser_init();
+    oj_tape_init();
     oj_scanner_init();
 
 #ifdef HAVE_SIMD_NEON
@@ -2571,7 +2600,7 @@ void Init_oj(void) {
 #endif /* HAVE_SIMD_NEON */
 
 #ifdef HAVE_SIMD_SSE4_2
-    if (SIMD_Impl == SIMD_SSE42) {
+    if (SIMD_SSE42 <= SIMD_Impl) {
         initialize_sse42();
     }
 #endif /* HAVE_SIMD_SSE4_2 */
@@ -0,0 +1,177 @@
+// Copyright (c) 2026, Peter Ohler, All rights reserved.
+// Licensed under the MIT License. See LICENSE file in the project root for license details.
+
+#include "only.h"
+
+#include "mem.h"
+
+VALUE oj_only_list(ojParser p, VALUE value, const char *name) {
+    volatile VALUE list;
+    long           i;
+
+    if (RB_TYPE_P(value, T_STRING)) {
+        value = rb_ary_new_from_args(1, value);
+    }
+    rb_check_type(value, T_ARRAY);
+    if (ONLY_MAX < RARRAY_LEN(value)) {
+        rb_raise(rb_eArgError, "%s is limited to %d paths", name, ONLY_MAX);
+    }
+    list = rb_ary_new_capa(RARRAY_LEN(value));
+    for (i = 0; i < RARRAY_LEN(value); i++) {
+        VALUE path = rb_ary_entry(value, i);
+
+        oj_only_check(p, path, name);
+        rb_ary_push(list, rb_str_new_frozen(path));
+    }
+    return rb_obj_freeze(list);
+}
+
+// Raises unless path is a JSON Pointer the parser can reach. The empty
+// pointer is the root, any other must start with a slash.
+void oj_only_check(ojParser p, VALUE path, const char *name) {
+    rb_check_type(path, T_STRING);
+    if (0 < RSTRING_LEN(path) && '/' != *RSTRING_PTR(path)) {
+        rb_raise(rb_eArgError, "%s path %s must be empty or start with a /", name, StringValueCStr(path));
+    }
+    if ((long)sizeof(p->stack) <= oj_only_depth(path)) {
+        rb_raise(rb_eArgError, "%s path %s is too deep", name, StringValueCStr(path));
+    }
+}
+
+Only oj_only_create(VALUE list) {
+    Only o = OJ_R_ALLOC(struct _only);
+    long i;
+
+    memset(o, 0, sizeof(struct _only));
+    o->list = list;
+    for (i = 0; i < RARRAY_LEN(list); i++) {
+        oj_only_path(o->paths + i, rb_ary_entry(list, i));
+        o->cnt++;
+        if (0 == o->paths[i].cnt) {
+            o->root_all = true;
+        } else {
+            o->root_alive |= (uint64_t)1 << i;
+        }
+    }
+    return o;
+}
+
+void oj_only_free(Only o) {
+    int i;
+
+    for (i = 0; i < o->cnt; i++) {
+        OJ_R_FREE(o->paths[i].segs);
+    }
+    OJ_R_FREE(o);
+}
+
+bool oj_only_keep(ojParser p, Only o, bool container) {
+    OnlyFrame f = o->frames + p->depth;
+    OnlyFrame c = f + 1;
+    uint64_t  alive;
+    long      index = -1;
+    int       i;
+
+    if (0 == p->depth) {
+        c->alive = o->root_alive;
+        c->all   = o->root_all;
+        c->index = 0;
+        return true;
+    }
+    if (f->all) {
+        c->all = true;
+        return true;
+    }
+    if (ARRAY_FUN == p->stack[p->depth]) {
+        index = f->index++;
+    }
+    alive = 0;
+    for (i = 0; i < o->cnt; i++) {
+        OnlySeg s;
+
+        if (0 == (f->alive & ((uint64_t)1 << i))) {
+            continue;
+        }
+        s = o->paths[i].segs + p->depth - 1;
+        if (s->any ||
+            (0 <= index ? s->index == index
+                        : (s->len == buf_len(&p->key) && 0 == memcmp(s->str, buf_str(&p->key), s->len)))) {
+            if (o->paths[i].cnt == p->depth) {
+                c->all = true;
+                return true;
+            }
+            alive |= (uint64_t)1 << i;
+        }
+    }
+    if (0 == alive || !container) {
+        return false;
+    }
+    c->alive = alive;
+    c->all   = false;
+    c->index = 0;
+
+    return true;
+}
+
+long oj_only_depth(VALUE path) {
+    const char *s   = RSTRING_PTR(path);
+    const char *end = s + RSTRING_LEN(path);
+    long        cnt = 0;
+
+    for (; s < end; s++) {
+        if ('/' == *s) {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+// Splits a JSON Pointer, already checked by oj_only_check(), into segments,
+// unescaping ~0 and ~1. Each slash starts a segment so "/" is the member
+// with an empty key. The segment strings are kept in the same allocation as
+// the segment array.
+void oj_only_path(OnlyPath op, VALUE path) {
+    const char *s;
+    const char *end;
+    char       *str;
+    OnlySeg     seg;
+    long        len;
+    int         cnt;
+
+    s   = RSTRING_PTR(path);
+    len = RSTRING_LEN(path);
+    end = s + len;
+    cnt = (int)oj_only_depth(path);
+    if (0 < cnt) {
+        s++;
+    }
+    op->cnt  = cnt;
+    op->segs = (OnlySeg)OJ_R_ALLOC_N(char, sizeof(struct _onlySeg) * cnt + len + 1);
+    str      = (char *)(op->segs + cnt);
+    for (seg = op->segs; seg < op->segs + cnt; seg++, s++) {
+        seg->str = str;
+        for (; s < end && '/' != *s; s++) {
+            if ('~' == *s && s + 1 < end && ('0' == s[1] || '1' == s[1])) {
+                s++;
+                *str++ = ('0' == *s) ? '~' : '/';
+            } else {
+                *str++ = *s;
+            }
+        }
+        seg->len   = str - seg->str;
+        seg->any   = (1 == seg->len && '*' == *seg->str);
+        seg->index = -1;
+        if (0 < seg->len && seg->len < 19 && ('0' != *seg->str || 1 == seg->len)) {
+            const char *d;
+
+            seg->index = 0;
+            for (d = seg->str; d < str; d++) {
+                if (*d < '0' || '9' < *d) {
+                    seg->index = -1;
+                    break;
+                }
+                seg->index = seg->index * 10 + (*d - '0');
+            }
+        }
+    }
+}
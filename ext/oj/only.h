@@ -0,0 +1,66 @@
+// Copyright (c) 2026, Peter Ohler, All rights reserved.
+// Licensed under the MIT License. See LICENSE file in the project root for license details.
+
+#ifndef OJ_ONLY_H
+#define OJ_ONLY_H
+
+#include <ruby.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+// An only filter limits a delegate to the values on a list of paths. A path
+// is a JSON Pointer such as "/data/*/id" where * matches any member of an
+// object or array. Arrays and objects off every path can be passed over by
+// the parser with a bracket matching scan.
+//
+// The paths still alive at each depth are kept as a bit mask so each member
+// is checked against the current key or index once as the parser reaches it
+// instead of comparing the whole key path.
+
+#define ONLY_MAX 64
+
+typedef struct _onlySeg {
+    const char *str;
+    size_t      len;
+    long        index;  // -1 if not an array index
+    bool        any;
+} *OnlySeg;
+
+typedef struct _onlyPath {
+    OnlySeg segs;
+    int     cnt;
+} *OnlyPath;
+
+typedef struct _onlyFrame {
+    uint64_t alive;  // paths that match so far
+    long     index;  // next array index
+    bool     all;    // on the end of a path so everything is kept
+} *OnlyFrame;
+
+typedef struct _only {
+    struct _onlyPath  paths[ONLY_MAX];
+    int               cnt;
+    uint64_t          root_alive;
+    bool              root_all;
+    VALUE             list;      // frozen copy of the option value
+    struct _funcs     funcs[3];  // the wrapped functions
+    struct _onlyFrame frames[1026];
+} *Only;
+
+// Checks a String or Array of Strings option value and returns a frozen
+// Array of frozen paths. The name is used in error messages.
+extern VALUE oj_only_list(ojParser p, VALUE value, const char *name);
+extern Only  oj_only_create(VALUE list);
+extern void  oj_only_free(Only o);
+
+// Returns true if the value the parser is about to add is on a path. For an
+// array or object the frame for its members is set up.
+extern bool oj_only_keep(ojParser p, Only o, bool container);
+
+extern void oj_only_check(ojParser p, VALUE path, const char *name);
+extern long oj_only_depth(VALUE path);
+extern void oj_only_path(OnlyPath op, VALUE path);
+
+#endif /* OJ_ONLY_H */
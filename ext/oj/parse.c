@@ -12,6 +12,7 @@
 
 #include "buf.h"
 #include "encode.h"
+#include "fast_float.h"
 #include "mem.h"
 #include "oj.h"
 #include "rxclass.h"
@@ -30,9 +31,13 @@ static void next_non_white(ParseInfo pi) {
         switch (*pi->cur) {
         case ' ':
         case '\t':
-        case '\f':
         case '\n':
-        case '\r': break;
+        case '\r':
+            if (' ' >= (unsigned char)pi->cur[1]) {
+                pi->cur = oj_skip_white(pi->cur, pi->end, NULL, NULL) - 1;
+            }
+            break;
+        case '\f': break;
         default: return;
         }
     }
@@ -127,57 +132,82 @@ static void read_false(ParseInfo pi) {
     }
 }
 
+// Hex digit values with 16 for anything that is not a hex digit.
+static const uint8_t hex_values[256] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 16, 16, 16, 16, 16, 16,
+    16, 10, 11, 12, 13, 14, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 10, 11, 12, 13, 14, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+};
+
+// The character each single character escape stands for, indexed by the
+// character after the backslash. Zero for 'u' and anything invalid.
+static const char simple_escapes[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0, 34,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 47,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 92,  0,  0,  0,
+     0,  0,  8,  0,  0,  0, 12,  0,  0,  0,  0,  0,  0,  0, 10,  0,
+     0,  0, 13,  0,  9,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
 static uint32_t read_hex(ParseInfo pi, const char *h) {
     uint32_t b = 0;
     int      i;
 
     for (i = 0; i < 4; i++, h++) {
-        b = b << 4;
-        if ('0' <= *h && *h <= '9') {
-            b += *h - '0';
-        } else if ('A' <= *h && *h <= 'F') {
-            b += *h - 'A' + 10;
-        } else if ('a' <= *h && *h <= 'f') {
-            b += *h - 'a' + 10;
-        } else {
+        uint8_t v = hex_values[(uint8_t)*h];
+
+        if (16 <= v) {
             oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "invalid hex character");
             return 0;
         }
+        b = (b << 4) | v;
     }
     return b;
 }
 
-static void unicode_to_chars(ParseInfo pi, Buf buf, uint32_t code) {
+// A \u escape, or a surrogate pair of them, never decodes past U+10FFFF so
+// at most four bytes are written to t.
+static char *unicode_to_chars(char *t, uint32_t code) {
     if (0x0000007F >= code) {
-        buf_append(buf, (char)code);
+        *t++ = (char)code;
     } else if (0x000007FF >= code) {
-        buf_append(buf, 0xC0 | (code >> 6));
-        buf_append(buf, 0x80 | (0x3F & code));
+        *t++ = 0xC0 | (code >> 6);
+        *t++ = 0x80 | (0x3F & code);
     } else if (0x0000FFFF >= code) {
-        buf_append(buf, 0xE0 | (code >> 12));
-        buf_append(buf, 0x80 | ((code >> 6) & 0x3F));
-        buf_append(buf, 0x80 | (0x3F & code));
-    } else if (0x001FFFFF >= code) {
-        buf_append(buf, 0xF0 | (code >> 18));
-        buf_append(buf, 0x80 | ((code >> 12) & 0x3F));
-        buf_append(buf, 0x80 | ((code >> 6) & 0x3F));
-        buf_append(buf, 0x80 | (0x3F & code));
-    } else if (0x03FFFFFF >= code) {
-        buf_append(buf, 0xF8 | (code >> 24));
-        buf_append(buf, 0x80 | ((code >> 18) & 0x3F));
-        buf_append(buf, 0x80 | ((code >> 12) & 0x3F));
-        buf_append(buf, 0x80 | ((code >> 6) & 0x3F));
-        buf_append(buf, 0x80 | (0x3F & code));
-    } else if (0x7FFFFFFF >= code) {
-        buf_append(buf, 0xFC | (code >> 30));
-        buf_append(buf, 0x80 | ((code >> 24) & 0x3F));
-        buf_append(buf, 0x80 | ((code >> 18) & 0x3F));
-        buf_append(buf, 0x80 | ((code >> 12) & 0x3F));
-        buf_append(buf, 0x80 | ((code >> 6) & 0x3F));
-        buf_append(buf, 0x80 | (0x3F & code));
+        *t++ = 0xE0 | (code >> 12);
+        *t++ = 0x80 | ((code >> 6) & 0x3F);
+        *t++ = 0x80 | (0x3F & code);
     } else {
-        oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "invalid Unicode character");
+        *t++ = 0xF0 | (code >> 18);
+        *t++ = 0x80 | ((code >> 12) & 0x3F);
+        *t++ = 0x80 | ((code >> 6) & 0x3F);
+        *t++ = 0x80 | (0x3F & code);
     }
+    return t;
 }
 
 static const unsigned char end_of_scan_string[] = {
@@ -369,14 +399,179 @@ static OJ_TARGET_SSE2 const char *scan_string_SSE2(const char *str, const char *
 }
 #endif
 
+#ifdef HAVE_SIMD_AVX2
+// AVX2 string scanner. Two 32 byte chunks are checked per pass and their
+// masks merged so there is only one branch per 64 bytes. The tail is left to
+// the SSE2 scanner.
+static OJ_TARGET_AVX2 const char *scan_string_AVX2(const char *str, const char *end) {
+    const __m256i null_char = _mm256_setzero_si256();
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i quote     = _mm256_set1_epi8('"');
+
+    for (; str + 64 <= end; str += 64) {
+        OJ_PREFETCH(str + 64);
+
+        const __m256i chunk0 = _mm256_loadu_si256((const __m256i *)(str));
+        const __m256i chunk1 = _mm256_loadu_si256((const __m256i *)(str + 32));
+        const __m256i cmp0   = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk0, null_char), _mm256_cmpeq_epi8(chunk0, backslash)),
+            _mm256_cmpeq_epi8(chunk0, quote));
+        const __m256i cmp1 = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk1, null_char), _mm256_cmpeq_epi8(chunk1, backslash)),
+            _mm256_cmpeq_epi8(chunk1, quote));
+        const uint64_t mask = (uint64_t)(uint32_t)_mm256_movemask_epi8(cmp0) |
+                              ((uint64_t)(uint32_t)_mm256_movemask_epi8(cmp1) << 32);
+
+        if (OJ_UNLIKELY(0 != mask)) {
+            return str + OJ_CTZ64(mask);
+        }
+    }
+    if (str + 32 <= end) {
+        const __m256i chunk   = _mm256_loadu_si256((const __m256i *)str);
+        const __m256i matches = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, null_char), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(chunk, quote));
+        const uint32_t mask = (uint32_t)_mm256_movemask_epi8(matches);
+
+        if (0 != mask) {
+            return str + OJ_CTZ(mask);
+        }
+        str += 32;
+    }
+    return scan_string_SSE2(str, end);
+}
+#endif
+
+#ifdef HAVE_SIMD_AVX512
+// AVX-512BW string scanner. The compares go straight to 64 bit mask registers
+// and the tail uses a masked load, which does not fault on the bytes left out,
+// so there is no scalar loop at all.
+static OJ_TARGET_AVX512 const char *scan_string_AVX512(const char *str, const char *end) {
+    const __m512i null_char = _mm512_setzero_si512();
+    const __m512i backslash = _mm512_set1_epi8('\\');
+    const __m512i quote     = _mm512_set1_epi8('"');
+    __m512i       chunk;
+    __mmask64     mask;
+
+    for (; str + 64 <= end; str += 64) {
+        OJ_PREFETCH(str + 64);
+
+        chunk = _mm512_loadu_si512((const void *)str);
+        mask  = _mm512_cmpeq_epi8_mask(chunk, null_char) | _mm512_cmpeq_epi8_mask(chunk, backslash) |
+               _mm512_cmpeq_epi8_mask(chunk, quote);
+        if (OJ_UNLIKELY(0 != mask)) {
+            return str + OJ_CTZ64(mask);
+        }
+    }
+    if (str < end) {
+        const __mmask64 valid = (__mmask64)(~0ULL >> (64 - (end - str)));
+
+        chunk = _mm512_maskz_loadu_epi8(valid, (const void *)str);
+        mask  = _mm512_mask_cmpeq_epi8_mask(valid, chunk, null_char) |
+               _mm512_mask_cmpeq_epi8_mask(valid, chunk, backslash) | _mm512_mask_cmpeq_epi8_mask(valid, chunk, quote);
+        if (0 != mask) {
+            return str + OJ_CTZ64(mask);
+        }
+        str = end;
+    }
+    return str;
+}
+#endif
+
 static const char *(*scan_func)(const char *str, const char *end) = scan_string_noSIMD;
 
+// White space skippers behind oj_skip_white(). Indentation is rarely more
+// than a few dozen bytes so the 16 byte kernel is used for every x86 tier.
+static const char *skip_white_noSIMD(const char *b, const char *end, long *line, const char **nl) {
+    for (; b < end; b++) {
+        switch (*b) {
+        case '\n':
+            if (NULL != line) {
+                (*line)++;
+                *nl = b;
+            }
+            break;
+        case ' ':
+        case '\t':
+        case '\r': break;
+        default: return b;
+        }
+    }
+    return b;
+}
+
+#ifdef HAVE_SIMD_SSE2
+static OJ_TARGET_SSE2 const char *skip_white_SSE2(const char *b, const char *end, long *line, const char **nl) {
+    const __m128i space   = _mm_set1_epi8(' ');
+    const __m128i tab     = _mm_set1_epi8('\t');
+    const __m128i cr      = _mm_set1_epi8('\r');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    for (; b + sizeof(__m128i) <= end; b += sizeof(__m128i)) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)b);
+        const __m128i nlv   = _mm_cmpeq_epi8(chunk, newline);
+        const __m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), nlv));
+        uint64_t      stop  = 0xFFFF & ~(uint64_t)_mm_movemask_epi8(white);
+        uint64_t      nls   = (uint64_t)_mm_movemask_epi8(nlv);
+
+        if (0 != stop) {
+            nls &= (stop & (0 - stop)) - 1;  // only the newlines before the stop
+        }
+        if (0 != nls && NULL != line) {
+            *line += OJ_POPCOUNT64(nls);
+            *nl = b + 63 - OJ_CLZ64(nls);
+        }
+        if (0 != stop) {
+            return b + OJ_CTZ64(stop);
+        }
+    }
+    return skip_white_noSIMD(b, end, line, nl);
+}
+#endif
+
+#ifdef HAVE_SIMD_NEON
+static const char *skip_white_neon(const char *b, const char *end, long *line, const char **nl) {
+    for (; b + sizeof(uint8x16_t) <= end; b += sizeof(uint8x16_t)) {
+        const uint8x16_t chunk = vld1q_u8((const uint8_t *)b);
+        const uint8x16_t nlv   = vceqq_u8(chunk, vdupq_n_u8('\n'));
+        const uint8x16_t white = vorrq_u8(vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(' ')), vceqq_u8(chunk, vdupq_n_u8('\t'))),
+                                          vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('\r')), nlv));
+        // Four bits per byte after the narrowing shift.
+        uint64_t stop = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(white), 4)), 0);
+        uint64_t nls  = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(nlv), 4)), 0);
+
+        stop &= 0x8888888888888888ULL;
+        nls &= 0x8888888888888888ULL;
+        if (0 != stop) {
+            nls &= (stop & (0 - stop)) - 1;
+        }
+        if (0 != nls && NULL != line) {
+            *line += OJ_POPCOUNT64(nls);
+            *nl = b + ((63 - OJ_CLZ64(nls)) >> 2);
+        }
+        if (0 != stop) {
+            return b + (OJ_CTZ64(stop) >> 2);
+        }
+    }
+    return skip_white_noSIMD(b, end, line, nl);
+}
+#endif
+
+static const char *(*skip_white_func)(const char *b, const char *end, long *line, const char **nl) = skip_white_noSIMD;
+
 void oj_scanner_init(void) {
     // Use runtime CPU detection to select the best SIMD implementation
     // This ensures we don't crash on CPUs that don't support SSE4.2
     SIMD_Implementation impl = oj_get_simd_implementation();
 
     switch (impl) {
+#ifdef HAVE_SIMD_AVX512
+    case SIMD_AVX512: scan_func = scan_string_AVX512; break;
+#endif
+#ifdef HAVE_SIMD_AVX2
+    case SIMD_AVX2: scan_func = scan_string_AVX2; break;
+#endif
 #ifdef HAVE_SIMD_SSE4_2
     case SIMD_SSE42: scan_func = scan_string_SSE42; break;
 #endif
@@ -388,6 +583,56 @@ void oj_scanner_init(void) {
 #endif
     default: scan_func = scan_string_noSIMD; break;
     }
+#ifdef HAVE_SIMD_SSE2
+    if (SIMD_SSE2 <= impl) {
+        skip_white_func = skip_white_SSE2;
+    }
+#endif
+#ifdef HAVE_SIMD_NEON
+    if (SIMD_NEON == impl) {
+        skip_white_func = skip_white_neon;
+    }
+#endif
+}
+
+// Returns the first '\0', '\\', or '"' in str before end, or end if there is
+// none. Used by the reader based parser in sparse.c.
+const char *oj_scan_string(const char *str, const char *end) {
+    return scan_func(str, end);
+}
+
+const char *oj_skip_white(const char *b, const char *end, long *line, const char **nl) {
+    // A single space after a colon or comma is not worth a vector compare.
+    if (end <= b + 1 || ' ' < (unsigned char)b[1]) {
+        return skip_white_noSIMD(b, end, line, nl);
+    }
+    return skip_white_func(b, end, line, nl);
+}
+
+// The runs between escapes are often only a few bytes long so the next eight
+// bytes are checked with SWAR before paying for a call to the vector scanner.
+// The lowest flagged byte of each zero byte test is exact so the first '\0',
+// '\\', or '"' is found even though higher bytes may be flagged falsely.
+static inline const char *scan_escaped_run(const char *s, const char *end) {
+#ifndef WORDS_BIGENDIAN
+    if (s + 8 <= end) {
+        const uint64_t ones = 0x0101010101010101ULL;
+        uint64_t       w;
+        uint64_t       q;
+        uint64_t       b;
+        uint64_t       m;
+
+        memcpy(&w, s, sizeof(w));
+        q = w ^ 0x2222222222222222ULL;
+        b = w ^ 0x5C5C5C5C5C5C5C5CULL;
+        m = (((w - ones) & ~w) | ((q - ones) & ~q) | ((b - ones) & ~b)) & 0x8080808080808080ULL;
+        if (0 != m) {
+            return s + (OJ_CTZ64(m) >> 3);
+        }
+        s += 8;
+    }
+#endif
+    return scan_func(s, end);
 }
 
 // entered at /
@@ -402,14 +647,20 @@ static void read_escaped_str(ParseInfo pi, const char *start) {
     buf_append_string(&buf, start, cnt);
 
     for (s = pi->cur; '"' != *s;) {
-        const char *scanned = scan_func(s, pi->end);
+        const char *scanned = scan_escaped_run(s, pi->end);
+
         if (scanned >= pi->end || '\0' == *scanned) {
             // if (scanned >= pi->end) {
             oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "quoted string not terminated");
             buf_cleanup(&buf);
             return;
         }
-        buf_append_string(&buf, s, (size_t)(scanned - s));
+        // No escape decodes to more bytes than it takes up in the JSON and
+        // the widest, a surrogate pair, decodes to four so reserving room
+        // for the run and four more lets the escape be written directly.
+        buf_reserve(&buf, (size_t)(scanned - s) + 4);
+        memcpy(buf.tail, s, (size_t)(scanned - s));
+        buf.tail += scanned - s;
         s = scanned;
 
         if ('\\' == *s) {
@@ -419,15 +670,12 @@ static void read_escaped_str(ParseInfo pi, const char *start) {
                 buf_cleanup(&buf);
                 return;
             }
+            if ('\0' != (*buf.tail = simple_escapes[(uint8_t)*s])) {
+                buf.tail++;
+                s++;
+                continue;
+            }
             switch (*s) {
-            case 'n': buf_append(&buf, '\n'); break;
-            case 'r': buf_append(&buf, '\r'); break;
-            case 't': buf_append(&buf, '\t'); break;
-            case 'f': buf_append(&buf, '\f'); break;
-            case 'b': buf_append(&buf, '\b'); break;
-            case '"': buf_append(&buf, '"'); break;
-            case '/': buf_append(&buf, '/'); break;
-            case '\\': buf_append(&buf, '\\'); break;
             case 'u':
                 s++;
                 if (0 == (code = read_hex(pi, s)) && err_has(&pi->err)) {
@@ -443,7 +691,7 @@ static void read_escaped_str(ParseInfo pi, const char *start) {
                     if ('\\' != *s || 'u' != *(s + 1)) {
                         if (Yes == pi->options.allow_invalid) {
                             s--;
-                            unicode_to_chars(pi, &buf, code);
+                            buf.tail = unicode_to_chars(buf.tail, code);
                             break;
                         }
                         pi->cur = s;
@@ -460,17 +708,13 @@ static void read_escaped_str(ParseInfo pi, const char *start) {
                     c2   = (c2 - 0x0000DC00) & 0x000003FF;
                     code = ((c1 << 10) | c2) + 0x00010000;
                 }
-                unicode_to_chars(pi, &buf, code);
-                if (err_has(&pi->err)) {
-                    buf_cleanup(&buf);
-                    return;
-                }
+                buf.tail = unicode_to_chars(buf.tail, code);
                 break;
             default:
                 // The json gem claims this is not an error despite the
                 // ECMA-404 indicating it is not valid.
                 if (CompatMode == pi->options.mode) {
-                    buf_append(&buf, *s);
+                    *buf.tail++ = *s;
                     break;
                 }
                 pi->cur = s;
@@ -969,13 +1213,6 @@ static VALUE parse_big_decimal(VALUE str) {
     return rb_funcall(rb_cObject, oj_bigdecimal_id, 1, str);
 }
 
-static long double exp_plus[] = {
-    1.0,    1.0e1,  1.0e2,  1.0e3,  1.0e4,  1.0e5,  1.0e6,  1.0e7,  1.0e8,  1.0e9,  1.0e10, 1.0e11, 1.0e12,
-    1.0e13, 1.0e14, 1.0e15, 1.0e16, 1.0e17, 1.0e18, 1.0e19, 1.0e20, 1.0e21, 1.0e22, 1.0e23, 1.0e24, 1.0e25,
-    1.0e26, 1.0e27, 1.0e28, 1.0e29, 1.0e30, 1.0e31, 1.0e32, 1.0e33, 1.0e34, 1.0e35, 1.0e36, 1.0e37, 1.0e38,
-    1.0e39, 1.0e40, 1.0e41, 1.0e42, 1.0e43, 1.0e44, 1.0e45, 1.0e46, 1.0e47, 1.0e48, 1.0e49,
-};
-
 static void validate_integer_size(size_t limit, NumInfo ni) {
     size_t digit_count = ni->len - (ni->neg ? 1 : 0);
 
@@ -990,6 +1227,18 @@ static void validate_integer_size(size_t limit, NumInfo ni) {
     }
 }
 
+// The integer and fraction digits are combined into one exact mantissa when
+// they fit in 64 bits. Anything else, including a number that does not end in
+// a digit, is left to the slower paths which also report bad floats.
+static bool num_fast_float(NumInfo ni, double *d) {
+    char c = ni->str[ni->len - 1];
+
+    if (c < '0' || '9' < c || 18 < ni->di || (INT64_MAX - ni->num) / ni->div < ni->i) {
+        return false;
+    }
+    return oj_fast_float((uint64_t)(ni->i * ni->div + ni->num), (int64_t)ni->exp - ni->di, ni->neg, d);
+}
+
 VALUE
 oj_num_as_value(NumInfo ni) {
     VALUE rnum = Qnil;
@@ -1039,34 +1288,20 @@ oj_num_as_value(NumInfo ni) {
             if (ni->no_big) {
                 rnum = rb_funcall(rnum, rb_intern("to_f"), 0);
             }
-        } else if (FastDec == ni->bigdec_load) {
-            long double ld = (long double)ni->i * (long double)ni->div + (long double)ni->num;
-            int         x  = (int)((int64_t)ni->exp - ni->di);
-
-            if (0 < x) {
-                if (x < (int)(sizeof(exp_plus) / sizeof(*exp_plus))) {
-                    ld *= exp_plus[x];
-                } else {
-                    ld *= powl(10.0, x);
-                }
-            } else if (x < 0) {
-                if (-x < (int)(sizeof(exp_plus) / sizeof(*exp_plus))) {
-                    ld /= exp_plus[-x];
-                } else {
-                    ld /= powl(10.0, -x);
-                }
-            }
-            if (ni->neg) {
-                ld = -ld;
-            }
-            rnum = rb_float_new((double)ld);
         } else if (RubyDec == ni->bigdec_load) {
             VALUE sv = rb_str_new(ni->str, ni->len);
 
             rnum = rb_funcall(sv, rb_intern("to_f"), 0);
         } else {
             char  *end;
-            double d = strtod(ni->str, &end);
+            double d;
+
+            // FastDec takes this path too so a number the fast conversion
+            // declines is still correctly rounded by strtod().
+            if (num_fast_float(ni, &d)) {
+                return rb_float_new(d);
+            }
+            d = strtod(ni->str, &end);
 
             if ((long)ni->len != (long)(end - ni->str)) {
                 if (Qnil == ni->pi->err_class) {
@@ -93,7 +93,8 @@ static inline void parse_info_init(ParseInfo pi) {
     memset(pi, 0, sizeof(struct _parseInfo));
 }
 
-extern void oj_scanner_init(void);
+extern void        oj_scanner_init(void);
+extern const char *oj_scan_string(const char *str, const char *end);
 
 static inline bool empty_ok(Options options) {
     switch (options->mode) {
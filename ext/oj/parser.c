@@ -2,27 +2,51 @@
 
 #include "parser.h"
 
+#include <errno.h>
 #include <fcntl.h>
+#include <ruby/io.h>
+#include <setjmp.h>
+#if HAVE_RB_THREAD_CALL_WITHOUT_GVL
+#include <ruby/thread.h>
+#endif
+#if !IS_WINDOWS && HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USE_MMAP 1
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#else
+#define USE_MMAP 0
+#endif
 
+#include "fast_float.h"
 #include "oj.h"
 #include "simd.h"
+#include "structural.h"
 
 #define DEBUG 0
 
 #define USE_THREAD_LIMIT 0
 // #define USE_THREAD_LIMIT 100000
 #define MAX_EXP 4932
-// max in the pow_map which is the limit for double
-#define MAX_POW 308
+
+// Documents shorter than this are parsed with the GVL held even if the
+// delegate does not need it as releasing and taking it back costs more than
+// it saves.
+#define GVL_FREE_MIN_LEN 65536
+
+// The buffer load reads an IO into starts at LOAD_BUF_MIN and doubles each
+// time a read fills it, up to LOAD_BUF_MAX.
+#define LOAD_BUF_MIN 16384
+#define LOAD_BUF_MAX (1024 * 1024)
 
 #define MIN_SLEEP (1000000000LL / (double)CLOCKS_PER_SEC)
 // 9,223,372,036,854,775,807
 #define BIG_LIMIT LLONG_MAX / 10
 #define FRAC_LIMIT 10000000000000000ULL
 
-// Give better performance with indented JSON but worse with unindented.
-// #define SPACE_JUMP
-
 enum {
     SKIP_CHAR        = 'a',
     SKIP_NEWLINE     = 'b',
@@ -356,16 +380,6 @@ SSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSS\
 ................................\
 ................................8";
 
-static const char space_map[258] = "\
-.........ab..a..................\
-a...............................\
-................................\
-................................\
-................................\
-................................\
-................................\
-................................S";
-
 static const char trail_map[258] = "\
 .........ab..a..................\
 a...............................\
@@ -386,37 +400,6 @@ static const byte hex_map[257] = "\
 ................................\
 ................................";
 
-static long double pow_map[309] = {
-    1.0L,     1.0e1L,   1.0e2L,   1.0e3L,   1.0e4L,   1.0e5L,   1.0e6L,   1.0e7L,   1.0e8L,   1.0e9L,   1.0e10L,
-    1.0e11L,  1.0e12L,  1.0e13L,  1.0e14L,  1.0e15L,  1.0e16L,  1.0e17L,  1.0e18L,  1.0e19L,  1.0e20L,  1.0e21L,
-    1.0e22L,  1.0e23L,  1.0e24L,  1.0e25L,  1.0e26L,  1.0e27L,  1.0e28L,  1.0e29L,  1.0e30L,  1.0e31L,  1.0e32L,
-    1.0e33L,  1.0e34L,  1.0e35L,  1.0e36L,  1.0e37L,  1.0e38L,  1.0e39L,  1.0e40L,  1.0e41L,  1.0e42L,  1.0e43L,
-    1.0e44L,  1.0e45L,  1.0e46L,  1.0e47L,  1.0e48L,  1.0e49L,  1.0e50L,  1.0e51L,  1.0e52L,  1.0e53L,  1.0e54L,
-    1.0e55L,  1.0e56L,  1.0e57L,  1.0e58L,  1.0e59L,  1.0e60L,  1.0e61L,  1.0e62L,  1.0e63L,  1.0e64L,  1.0e65L,
-    1.0e66L,  1.0e67L,  1.0e68L,  1.0e69L,  1.0e70L,  1.0e71L,  1.0e72L,  1.0e73L,  1.0e74L,  1.0e75L,  1.0e76L,
-    1.0e77L,  1.0e78L,  1.0e79L,  1.0e80L,  1.0e81L,  1.0e82L,  1.0e83L,  1.0e84L,  1.0e85L,  1.0e86L,  1.0e87L,
-    1.0e88L,  1.0e89L,  1.0e90L,  1.0e91L,  1.0e92L,  1.0e93L,  1.0e94L,  1.0e95L,  1.0e96L,  1.0e97L,  1.0e98L,
-    1.0e99L,  1.0e100L, 1.0e101L, 1.0e102L, 1.0e103L, 1.0e104L, 1.0e105L, 1.0e106L, 1.0e107L, 1.0e108L, 1.0e109L,
-    1.0e110L, 1.0e111L, 1.0e112L, 1.0e113L, 1.0e114L, 1.0e115L, 1.0e116L, 1.0e117L, 1.0e118L, 1.0e119L, 1.0e120L,
-    1.0e121L, 1.0e122L, 1.0e123L, 1.0e124L, 1.0e125L, 1.0e126L, 1.0e127L, 1.0e128L, 1.0e129L, 1.0e130L, 1.0e131L,
-    1.0e132L, 1.0e133L, 1.0e134L, 1.0e135L, 1.0e136L, 1.0e137L, 1.0e138L, 1.0e139L, 1.0e140L, 1.0e141L, 1.0e142L,
-    1.0e143L, 1.0e144L, 1.0e145L, 1.0e146L, 1.0e147L, 1.0e148L, 1.0e149L, 1.0e150L, 1.0e151L, 1.0e152L, 1.0e153L,
-    1.0e154L, 1.0e155L, 1.0e156L, 1.0e157L, 1.0e158L, 1.0e159L, 1.0e160L, 1.0e161L, 1.0e162L, 1.0e163L, 1.0e164L,
-    1.0e165L, 1.0e166L, 1.0e167L, 1.0e168L, 1.0e169L, 1.0e170L, 1.0e171L, 1.0e172L, 1.0e173L, 1.0e174L, 1.0e175L,
-    1.0e176L, 1.0e177L, 1.0e178L, 1.0e179L, 1.0e180L, 1.0e181L, 1.0e182L, 1.0e183L, 1.0e184L, 1.0e185L, 1.0e186L,
-    1.0e187L, 1.0e188L, 1.0e189L, 1.0e190L, 1.0e191L, 1.0e192L, 1.0e193L, 1.0e194L, 1.0e195L, 1.0e196L, 1.0e197L,
-    1.0e198L, 1.0e199L, 1.0e200L, 1.0e201L, 1.0e202L, 1.0e203L, 1.0e204L, 1.0e205L, 1.0e206L, 1.0e207L, 1.0e208L,
-    1.0e209L, 1.0e210L, 1.0e211L, 1.0e212L, 1.0e213L, 1.0e214L, 1.0e215L, 1.0e216L, 1.0e217L, 1.0e218L, 1.0e219L,
-    1.0e220L, 1.0e221L, 1.0e222L, 1.0e223L, 1.0e224L, 1.0e225L, 1.0e226L, 1.0e227L, 1.0e228L, 1.0e229L, 1.0e230L,
-    1.0e231L, 1.0e232L, 1.0e233L, 1.0e234L, 1.0e235L, 1.0e236L, 1.0e237L, 1.0e238L, 1.0e239L, 1.0e240L, 1.0e241L,
-    1.0e242L, 1.0e243L, 1.0e244L, 1.0e245L, 1.0e246L, 1.0e247L, 1.0e248L, 1.0e249L, 1.0e250L, 1.0e251L, 1.0e252L,
-    1.0e253L, 1.0e254L, 1.0e255L, 1.0e256L, 1.0e257L, 1.0e258L, 1.0e259L, 1.0e260L, 1.0e261L, 1.0e262L, 1.0e263L,
-    1.0e264L, 1.0e265L, 1.0e266L, 1.0e267L, 1.0e268L, 1.0e269L, 1.0e270L, 1.0e271L, 1.0e272L, 1.0e273L, 1.0e274L,
-    1.0e275L, 1.0e276L, 1.0e277L, 1.0e278L, 1.0e279L, 1.0e280L, 1.0e281L, 1.0e282L, 1.0e283L, 1.0e284L, 1.0e285L,
-    1.0e286L, 1.0e287L, 1.0e288L, 1.0e289L, 1.0e290L, 1.0e291L, 1.0e292L, 1.0e293L, 1.0e294L, 1.0e295L, 1.0e296L,
-    1.0e297L, 1.0e298L, 1.0e299L, 1.0e300L, 1.0e301L, 1.0e302L, 1.0e303L, 1.0e304L, 1.0e305L, 1.0e306L, 1.0e307L,
-    1.0e308L};
-
 static VALUE parser_class;
 
 // Works with extended unicode as well. \Uffffffff if support is desired in
@@ -463,8 +446,22 @@ static void parser_reset(ojParser p) {
     p->map      = value_map;
     p->next_map = NULL;
     p->depth    = 0;
+    p->skip     = 0;
+    p->skip_str = false;
+    p->skip_esc = false;
+    p->feeding  = false;
 }
 
+// State for a parse run without the GVL. Errors can not be raised there so
+// parse_error() leaves the message here and jumps back to the caller.
+struct _noGvl {
+    ojParser    p;
+    const byte *json;
+    size_t      len;
+    jmp_buf     jmp;
+    char        msg[300];
+};
+
 static void parse_error(ojParser p, const char *fmt, ...) {
     va_list ap;
     char    buf[256];
@@ -472,6 +469,10 @@ static void parse_error(ojParser p, const char *fmt, ...) {
     va_start(ap, fmt);
     vsnprintf(buf, sizeof(buf), fmt, ap);
     va_end(ap);
+    if (NULL != p->no_gvl) {
+        snprintf(p->no_gvl->msg, sizeof(p->no_gvl->msg), "%s at %ld:%ld", buf, p->line, p->col);
+        longjmp(p->no_gvl->jmp, 1);
+    }
     rb_raise(oj_json_parser_error_class, "%s at %ld:%ld", buf, p->line, p->col);
 }
 
@@ -503,29 +504,11 @@ static void calc_num(ojParser p) {
         p->funcs[p->stack[p->depth]].add_int(p);
         break;
     case OJ_DECIMAL: {
-        long double d = (long double)p->num.fixnum;
+        int64_t exp = p->num.exp_neg ? -(int64_t)p->num.exp : (int64_t)p->num.exp;
 
-        if (p->num.neg) {
-            d = -d;
-        }
-        if (0 < p->num.shift) {
-            d /= pow_map[p->num.shift];
-        }
-        if (0 < p->num.exp) {
-            long double x;
-
-            if (MAX_POW < p->num.exp) {
-                x = powl(10.0L, (long double)p->num.exp);
-            } else {
-                x = pow_map[p->num.exp];
-            }
-            if (p->num.exp_neg) {
-                d /= x;
-            } else {
-                d *= x;
-            }
-        }
-        p->num.dub = d;
+        // The fixnum holds every significant digit and the shift counts every
+        // fraction digit so the conversion is correctly rounded.
+        p->num.dub = oj_decimal_to_double((uint64_t)p->num.fixnum, exp - p->num.shift, p->num.neg);
         p->funcs[p->stack[p->depth]].add_float(p);
         break;
     }
@@ -537,6 +520,52 @@ static void calc_num(ojParser p) {
     p->type = OJ_NONE;
 }
 
+// Eight ASCII digits are folded into fixnum with SWAR arithmetic on one 64
+// bit word instead of a multiply and add per digit. Only full runs of eight
+// are taken and only while the result stays well below the limit. The byte
+// at a time loop that follows finishes the number so the transition to
+// OJ_BIG in big_change() happens at exactly the same digit as before. Returns
+// the number of digits consumed.
+#ifndef WORDS_BIGENDIAN
+static inline bool swar_eight_digits(uint64_t v) {
+    return 0x3333333333333333ULL ==
+           ((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4));
+}
+
+static inline uint64_t swar_eight_value(uint64_t v) {
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >>
+        32;
+
+    return v;
+}
+#endif
+
+static inline int swar_digits(const byte *b, const byte *end, int64_t *fixnum, uint64_t limit) {
+    int cnt = 0;
+#ifndef WORDS_BIGENDIAN
+    uint64_t v;
+
+    while (b + 8 <= end && (uint64_t)*fixnum < limit / 100000000ULL) {
+        memcpy(&v, b, sizeof(v));
+        if (!swar_eight_digits(v)) {
+            break;
+        }
+        *fixnum = (int64_t)((uint64_t)*fixnum * 100000000ULL + swar_eight_value(v));
+        cnt += 8;
+        b += 8;
+    }
+#else
+    (void)b;
+    (void)end;
+    (void)fixnum;
+    (void)limit;
+#endif
+    return cnt;
+}
+
 static void big_change(ojParser p) {
     char    buf[32];
     int64_t i   = p->num.fixnum;
@@ -558,20 +587,36 @@ static void big_change(ojParser p) {
         p->type = OJ_BIG;
         break;
     case OJ_DECIMAL: {
-        int shift = p->num.shift;
-
-        for (len = sizeof(buf) - 1; 0 < i; len--, i /= 10, shift--) {
-            if (0 == shift) {
-                buf[len] = '.';
-                len--;
-            }
+        uint32_t shift = p->num.shift;
+        uint32_t cnt;
+
+        // The digits of fixnum are split at shift by the dot. Leading zeros
+        // in the fraction are not in fixnum so there may be any number of
+        // them. At least one integer digit is written so BigDecimal() accepts
+        // the string.
+        len = sizeof(buf);
+        do {
+            len--;
             buf[len] = '0' + (i % 10);
-        }
+            i /= 10;
+        } while (0 < i);
+        cnt = sizeof(buf) - len;
         if (p->num.neg) {
-            buf[len] = '-';
-            len--;
+            buf_append(&p->buf, '-');
+        }
+        if (shift < cnt) {
+            buf_append_string(&p->buf, buf + len, cnt - shift);
+            if (0 < shift) {
+                buf_append(&p->buf, '.');
+                buf_append_string(&p->buf, buf + len + cnt - shift, shift);
+            }
+        } else {
+            buf_append_string(&p->buf, "0.", 2);
+            for (; cnt < shift; shift--) {
+                buf_append(&p->buf, '0');
+            }
+            buf_append_string(&p->buf, buf + len, cnt);
         }
-        buf_append_string(&p->buf, buf + len + 1, sizeof(buf) - len - 1);
         if (0 < p->num.exp) {
             int  x = p->num.exp;
             int  d, div;
@@ -585,6 +630,7 @@ static void big_change(ojParser p) {
                 d = x / div % 10;
                 if (started || 0 < d) {
                     buf_append(&p->buf, '0' + d);
+                    started = true;
                 }
             }
         }
@@ -596,7 +642,7 @@ static void big_change(ojParser p) {
 }
 
 // Scan forward over string content, returning the first byte that is not
-// STR_OK in string_map. This is a pure drop-in for the scalar loop
+// STR_OK in string_map. Each kernel is a pure drop-in for the scalar loop
 //
 //     for (; STR_OK == string_map[*b]; b++) {}
 //
@@ -608,84 +654,288 @@ static void big_change(ojParser p) {
 //     * the backslash  0x5C '\'    (class 'A')
 //     * every high byte 0x80..0xFF (UTF-8 lead/continuation, classes M/P/Q/'.')
 //
-// Note this differs from parse.c's string_scan_neon, which stops only on
-// \0 \\ " -- parser.c hands multi-byte UTF-8 to its state machine, so the
-// scanner must stop on the high bytes too. The predictor below is derived from
+// Note this differs from parse.c's scanners, which stop only on \0 \\ " --
+// parser.c hands multi-byte UTF-8 to its state machine, so the scanner must
+// stop on the high bytes too. The predicates below are derived from
 // string_map, not copied from parse.c.
 //
-// The NEON path only loads a full 16-byte vector when [b, b+16) stays within
-// [., end), so it never reads past the string's allocation; the sub-16-byte
-// tail (and the whole scan on non-NEON builds) uses the scalar loop, which
-// stops naturally at the guaranteed NUL terminator.
-static inline const byte *oj_scan_str_simd(const byte *b, const byte *end) {
+// The vector paths only load a full vector when [b, b+width) stays within
+// [., end), so they never read past the string's allocation; the tail uses the
+// scalar loop, which stops naturally at the guaranteed NUL terminator. The
+// kernel is picked once in oj_parser_init() from SIMD_Impl.
+static const byte *scan_str(const byte *b, const byte *end) {
+    (void)end;
+    for (; STR_OK == string_map[*b]; b++) {
+    }
+    return b;
+}
+
 #ifdef HAVE_SIMD_NEON
-    if (SIMD_NEON == SIMD_Impl) {
-        const uint8x16_t quote  = vdupq_n_u8('"');
-        const uint8x16_t bslash = vdupq_n_u8('\\');
-        const uint8x16_t space  = vdupq_n_u8(0x20);
-        const uint8x16_t high   = vdupq_n_u8(0x80);
-
-        while (b + sizeof(uint8x16_t) <= end) {
-            const uint8x16_t chunk = vld1q_u8((const uint8_t *)b);
-            // special lane == 0xFF for any byte that stops the scan.
-            const uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, bslash)),
-                                                vorrq_u8(vcltq_u8(chunk, space), vcgeq_u8(chunk, high)));
-            // Reduce to a 64-bit mask with 4 bits per lane (same idiom as
-            // parse.c's string_scan_neon) and locate the first set lane.
-            const uint8x8_t res  = vshrn_n_u16(vreinterpretq_u16_u8(special), 4);
-            uint64_t        mask = vget_lane_u64(vreinterpret_u64_u8(res), 0);
-            if (0 != mask) {
-                mask &= 0x8888888888888888ull;
-                return b + (OJ_CTZ64(mask) >> 2);
-            }
-            b += sizeof(uint8x16_t);
+static const byte *scan_str_neon(const byte *b, const byte *end) {
+    const uint8x16_t quote  = vdupq_n_u8('"');
+    const uint8x16_t bslash = vdupq_n_u8('\\');
+    const uint8x16_t space  = vdupq_n_u8(0x20);
+    const uint8x16_t high   = vdupq_n_u8(0x80);
+
+    while (b + sizeof(uint8x16_t) <= end) {
+        const uint8x16_t chunk = vld1q_u8((const uint8_t *)b);
+        // special lane == 0xFF for any byte that stops the scan.
+        const uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, bslash)),
+                                            vorrq_u8(vcltq_u8(chunk, space), vcgeq_u8(chunk, high)));
+        // Reduce to a 64-bit mask with 4 bits per lane (same idiom as
+        // parse.c's string_scan_neon) and locate the first set lane.
+        const uint8x8_t res  = vshrn_n_u16(vreinterpretq_u16_u8(special), 4);
+        uint64_t        mask = vget_lane_u64(vreinterpret_u64_u8(res), 0);
+        if (0 != mask) {
+            mask &= 0x8888888888888888ull;
+            return b + (OJ_CTZ64(mask) >> 2);
         }
+        b += sizeof(uint8x16_t);
     }
-#else
-    (void)end;
+    return scan_str(b, end);
+}
 #endif
-    for (; STR_OK == string_map[*b]; b++) {
+
+#ifdef HAVE_SIMD_SSE2
+// A byte is a control byte if the unsigned min of it and 0x1F is the byte
+// itself. The high bytes are the sign bits which movemask picks up directly.
+static OJ_TARGET_SSE2 const byte *scan_str_sse2(const byte *b, const byte *end) {
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl   = _mm_set1_epi8(0x1F);
+
+    while (b + sizeof(__m128i) <= end) {
+        const __m128i chunk   = _mm_loadu_si128((const __m128i *)b);
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, bslash)),
+                                             _mm_cmpeq_epi8(_mm_min_epu8(chunk, ctrl), chunk));
+        const int     mask    = _mm_movemask_epi8(special) | _mm_movemask_epi8(chunk);
+
+        if (0 != mask) {
+            return b + OJ_CTZ64((uint64_t)mask);
+        }
+        b += sizeof(__m128i);
+    }
+    return scan_str(b, end);
+}
+#endif
+
+#ifdef HAVE_SIMD_SSE4_2
+// The stop set is four byte ranges which _mm_cmpestri can match in one
+// instruction.
+static OJ_TARGET_SSE42 const byte *scan_str_sse42(const byte *b, const byte *end) {
+    static const char ranges[16] = "\x00\x1F\"\"\\\\\x80\xFF";
+    const __m128i     stops      = _mm_loadu_si128((const __m128i *)ranges);
+
+    while (b + sizeof(__m128i) <= end) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)b);
+        const int     i =
+            _mm_cmpestri(stops, 8, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+
+        if (16 != i) {
+            return b + i;
+        }
+        b += sizeof(__m128i);
+    }
+    return scan_str(b, end);
+}
+#endif
+
+#ifdef HAVE_SIMD_AVX2
+static OJ_TARGET_AVX2 const byte *scan_str_avx2(const byte *b, const byte *end) {
+    const __m256i quote  = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl   = _mm256_set1_epi8(0x1F);
+
+    while (b + sizeof(__m256i) <= end) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i *)b);
+        const __m256i special =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, bslash)),
+                            _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, ctrl), chunk));
+        const uint32_t mask = (uint32_t)(_mm256_movemask_epi8(special) | _mm256_movemask_epi8(chunk));
+
+        if (0 != mask) {
+            return b + OJ_CTZ64((uint64_t)mask);
+        }
+        b += sizeof(__m256i);
+    }
+    return scan_str_sse2(b, end);
+}
+#endif
+
+static const byte *(*scan_str_func)(const byte *b, const byte *end) = scan_str;
+
+// Keys and short values usually end within eight bytes so the first word is
+// checked in place with SWAR and only longer strings pay for the call into
+// the vector kernel. A byte stops the scan if it is below 0x20, a quote, a
+// backslash, or has the high bit set. Borrows only flag bytes after a real
+// stop so the lowest flag is exact.
+static inline const byte *scan_string(const byte *b, const byte *end) {
+#ifndef WORDS_BIGENDIAN
+    if (b + 8 <= end) {
+        const uint64_t ones  = 0x0101010101010101ULL;
+        const uint64_t highs = 0x8080808080808080ULL;
+        uint64_t       v;
+        uint64_t       q;
+        uint64_t       bs;
+        uint64_t       stop;
+
+        memcpy(&v, b, sizeof(v));
+        q    = v ^ (ones * '"');
+        bs   = v ^ (ones * '\\');
+        stop = (v | ((v - ones * 0x20) & ~v) | ((q - ones) & ~q) | ((bs - ones) & ~bs)) & highs;
+        if (0 != stop) {
+            return b + OJ_CTZ64(stop) / 8;
+        }
+        b += 8;
+    }
+#endif
+    return scan_str_func(b, end);
+}
+
+// Skips white space in documents too small for the structural index. The
+// newlines passed over are counted the same as the index does for them.
+static inline const byte *skip_white(ojParser p, const byte *b, const byte *end, const byte *json) {
+    const char *nl = NULL;
+
+    b = (const byte *)oj_skip_white((const char *)b, (const char *)end, &p->line, &nl);
+    if (NULL != nl) {
+        p->col = (long)(nl - (const char *)json);
+    }
+    return b;
+}
+
+// Skips white space directly until a run long enough to pay for the
+// structural index turns up in a large document. From then on the index is
+// used until OJ_INDEX_SHORT_MAX skips in a row end in their first block.
+static inline const byte *index_skip_white(ojParser    p,
+                                           ojIndex    *xp,
+                                           ojIndex     index,
+                                           const byte *b,
+                                           const byte *end,
+                                           const byte *json) {
+    const byte *start = b;
+
+    if (NULL == *xp) {
+        b = skip_white(p, b, end, json);
+        if (OJ_INDEX_RUN_MIN <= b - start && OJ_INDEX_MIN_LEN <= end - json) {
+            oj_index_start(index, json, end);
+            *xp = index;
+        }
+        return b;
+    }
+    b = oj_index_skip_white(*xp, b, json, &p->line, &p->col);
+    if (OJ_INDEX_BLOCK <= b - start) {
+        (*xp)->shorts = 0;
+    } else if (OJ_INDEX_SHORT_MAX <= ++(*xp)->shorts) {
+        *xp = NULL;
     }
     return b;
 }
 
+// Passes over the rest of a container the delegate asked to skip by matching
+// brackets outside of strings. Nothing in the container is checked beyond
+// that. Returns the closing bracket or, if the input ends first, the last
+// byte so parsing can pick up where it left off with the next block.
+static const byte *skip_container(ojParser p, const byte *b, const byte *end, const byte *json) {
+    if (p->skip_esc) {
+        p->skip_esc = false;
+        if ('\0' == *b) {
+            return b - 1;
+        }
+        b++;
+    }
+    for (; '\0' != *b; b++) {
+        if (p->skip_str) {
+            b = scan_str_func(b, end);
+            switch (*b) {
+            case '"': p->skip_str = false; continue;
+            case '\\':
+                if ('\0' == b[1]) {
+                    p->skip_esc = true;
+                    return b;
+                }
+                b++;
+                continue;
+            case '\0': return b - 1;
+            default: continue;  // multibyte UTF-8 or a control character
+            }
+        }
+        switch (*b) {
+        case '"': p->skip_str = true; break;
+        case '[':
+        case '{': p->skip++; break;
+        case ']':
+        case '}':
+            if (0 == --p->skip) {
+                p->map = (0 == p->depth) ? value_map : after_map;
+                return b;
+            }
+            break;
+        case '\n':
+            p->line++;
+            p->col = b - json;
+            break;
+        default: break;
+        }
+    }
+    return b - 1;
+}
+
+// A number ends at the first byte that can not be part of it so a number
+// that is the last value at the top level is only added once the end of the
+// input is reached.
+static void close_top_num(ojParser p) {
+    if (0 != p->depth) {
+        return;
+    }
+    switch (p->map[256]) {
+    case '0':
+    case 'd':
+    case 'f':
+    case 'z':
+    case 'X':
+    case 'D':
+    case 'g':
+    case 'B':
+    case 'Y':
+        calc_num(p);
+        p->map = value_map;
+        break;
+    }
+}
+
 static void parse(ojParser p, const byte *json, size_t len, bool more) {
     const byte *start;
     const byte *b   = json;
     const byte *end = json + len;
     int         i;
+    struct _ojIndex index;
+    ojIndex         x = NULL;
 
     p->line = 1;
     p->col  = -1;
 #if DEBUG
     printf("*** parse - mode: %c %s\n", p->map[256], (const char *)json);
 #endif
+    if (0 < p->skip) {
+        b = skip_container(p, b, end, json) + 1;
+        if (0 < p->skip) {
+            return;
+        }
+    }
     for (; '\0' != *b; b++) {
 #if DEBUG
         printf("*** parse - mode: %c %02x %s => %c\n", p->map[256], *b, b, p->map[*b]);
 #endif
         switch (p->map[*b]) {
-        case SKIP_NEWLINE:
-            p->line++;
-            p->col = b - json;
-            b++;
-#ifdef SPACE_JUMP
-            // for (uint32_t *sj = (uint32_t*)b; 0x20202020 == *sj; sj++) { b += 4; }
-            for (uint16_t *sj = (uint16_t *)b; 0x2020 == *sj; sj++) {
-                b += 2;
-            }
-#endif
-            for (; SKIP_CHAR == space_map[*b]; b++) {
-            }
-            b--;
-            break;
+        case SKIP_NEWLINE: b = index_skip_white(p, &x, &index, b, end, json) - 1; break;
         case COLON_COLON: p->map = value_map; break;
         case SKIP_CHAR: break;
         case KEY_QUOTE:
             b++;
             p->key.tail = p->key.head;
             start       = b;
-            b           = oj_scan_str_simd(b, end);
+            b           = scan_string(b, end);
             buf_append_string(&p->key, (const char *)start, b - start);
             if ('"' == *b) {
                 p->map = colon_map;
@@ -709,14 +959,21 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             b++;
             start       = b;
             p->buf.tail = p->buf.head;
-            b           = oj_scan_str_simd(b, end);
-            buf_append_string(&p->buf, (const char *)start, b - start);
+            b           = scan_string(b, end);
             if ('"' == *b) {
                 p->cur = b - json;
+                if (p->str_direct) {
+                    p->str     = (const char *)start;
+                    p->str_len = b - start;
+                } else {
+                    buf_append_string(&p->buf, (const char *)start, b - start);
+                }
                 p->funcs[p->stack[p->depth]].add_str(p);
                 p->map = (0 == p->depth) ? value_map : after_map;
                 break;
-            } else if ('\0' == *b && !more) {
+            }
+            buf_append_string(&p->buf, (const char *)start, b - start);
+            if ('\0' == *b && !more) {
                 parse_error(p, "quoted string not terminated");
                 break;
             }
@@ -727,6 +984,10 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
         case OPEN_OBJECT:
             p->cur = b - json;
             p->funcs[p->stack[p->depth]].open_object(p);
+            if (0 < p->skip) {
+                b = skip_container(p, b + 1, end, json);
+                break;
+            }
             p->depth++;
             if ((int)sizeof(p->stack) <= p->depth) {
                 parse_error(p, "too deeply nested");
@@ -753,6 +1014,10 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
         case OPEN_ARRAY:
             p->cur = b - json;
             p->funcs[p->stack[p->depth]].open_array(p);
+            if (0 < p->skip) {
+                b = skip_container(p, b + 1, end, json);
+                break;
+            }
             p->depth++;
             if ((int)sizeof(p->stack) <= p->depth) {
                 parse_error(p, "too deeply nested");
@@ -815,6 +1080,7 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             p->num.exp_neg = false;
             p->num.len     = 0;
             p->map         = digit_map;
+            b += swar_digits(b, end, &p->num.fixnum, BIG_LIMIT);
             for (; NUM_DIGIT == digit_map[*b]; b++) {
                 uint64_t x = (uint64_t)p->num.fixnum * 10 + (uint64_t)(*b - '0');
 
@@ -832,6 +1098,7 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             b--;
             break;
         case NUM_DIGIT:
+            b += swar_digits(b, end, &p->num.fixnum, BIG_LIMIT);
             for (; NUM_DIGIT == digit_map[*b]; b++) {
                 uint64_t x = p->num.fixnum * 10 + (uint64_t)(*b - '0');
 
@@ -851,6 +1118,9 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             break;
         case NUM_FRAC:
             p->map = frac_map;
+            i      = swar_digits(b, end, &p->num.fixnum, FRAC_LIMIT);
+            b += i;
+            p->num.shift += i;
             for (; NUM_FRAC == frac_map[*b]; b++) {
                 uint64_t x = p->num.fixnum * 10 + (uint64_t)(*b - '0');
 
@@ -859,6 +1129,9 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
                     p->num.shift++;
                 } else {
                     big_change(p);
+                    if (0 == p->num.shift) {
+                        buf_append(&p->buf, '.');
+                    }
                     p->map = big_frac_map;
                     break;
                 }
@@ -871,6 +1144,8 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             break;
         case NUM_ZERO: p->map = zero_map; break;
         case NEG_DIGIT:
+            p->map = digit_map;
+            b += swar_digits(b, end, &p->num.fixnum, BIG_LIMIT);
             for (; NUM_DIGIT == digit_map[*b]; b++) {
                 uint64_t x = p->num.fixnum * 10 + (uint64_t)(*b - '0');
 
@@ -883,7 +1158,6 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
                 }
             }
             b--;
-            p->map = digit_map;
             break;
         case EXP_SIGN:
             p->num.exp_neg = ('-' == *b);
@@ -942,31 +1216,26 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
         case NUM_SPC:
             p->cur = b - json;
             calc_num(p);
+            p->map = (0 == p->depth) ? value_map : after_map;
             break;
         case NUM_NEWLINE:
             p->cur = b - json;
             calc_num(p);
-            b++;
-#ifdef SPACE_JUMP
-            // for (uint32_t *sj = (uint32_t*)b; 0x20202020 == *sj; sj++) { b += 4; }
-            for (uint16_t *sj = (uint16_t *)b; 0x2020 == *sj; sj++) {
-                b += 2;
-            }
-#endif
-            for (; SKIP_CHAR == space_map[*b]; b++) {
-            }
-            b--;
+            p->map = (0 == p->depth) ? value_map : after_map;
+            b = index_skip_white(p, &x, &index, b + 1, end, json) - 1;
             break;
         case STR_OK:
             start = b;
-            b     = oj_scan_str_simd(b, end);
+            b     = scan_string(b, end);
             if (':' == p->next_map[256]) {
                 buf_append_string(&p->key, (const char *)start, b - start);
             } else {
                 buf_append_string(&p->buf, (const char *)start, b - start);
             }
             if ('"' == *b) {
-                p->cur = b - json;
+                p->cur     = b - json;
+                p->str     = buf_str(&p->buf);
+                p->str_len = buf_len(&p->buf);
                 p->funcs[p->stack[p->depth]].add_str(p);
                 p->map = p->next_map;
                 break;
@@ -975,7 +1244,9 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             break;
         case STR_SLASH: p->map = esc_map; break;
         case STR_QUOTE:
-            p->cur = b - json;
+            p->cur     = b - json;
+            p->str     = buf_str(&p->buf);
+            p->str_len = buf_len(&p->buf);
             p->funcs[p->stack[p->depth]].add_str(p);
             p->map = p->next_map;
             break;
@@ -1181,23 +1452,10 @@ static void parse(ojParser p, const byte *json, size_t len, bool more) {
             p->map = trail_map;
         }
     }
-    if (0 == p->depth) {
-        switch (p->map[256]) {
-        case '0':
-        case 'd':
-        case 'f':
-        case 'z':
-        case 'X':
-        case 'D':
-        case 'g':
-        case 'B':
-        case 'Y':
-            p->cur = b - json;
-            calc_num(p);
-            break;
-        }
+    if (!more) {
+        p->cur = b - json;
+        close_top_num(p);
     }
-    return;
 }
 
 static void parser_free(void *ptr) {
@@ -1244,6 +1502,7 @@ extern void oj_set_parser_saj(ojParser p);
 extern void oj_set_parser_usual(ojParser p);
 extern void oj_set_parser_debug(ojParser p);
 extern void oj_set_parser_safe(ojParser p, VALUE options);
+extern void oj_set_parser_tape(ojParser p);
 extern void oj_safe_init(VALUE parser_class);
 
 static int opt_cb(VALUE rkey, VALUE value, VALUE ptr) {
@@ -1313,7 +1572,7 @@ static VALUE parser_new(int argc, VALUE *argv, VALUE self) {
                 mode = rb_sym2str(mode);
                 // fall through
             case RUBY_T_STRING: ms = RSTRING_PTR(mode); break;
-            default: rb_raise(rb_eArgError, "mode must be :validate, :usual, :saj, or :object");
+            default: rb_raise(rb_eArgError, "mode must be :validate, :usual, :saj, :tape, or :object");
             }
             if (0 == strcmp("usual", ms) || 0 == strcmp("standard", ms) || 0 == strcmp("strict", ms) ||
                 0 == strcmp("compat", ms)) {
@@ -1324,10 +1583,12 @@ static VALUE parser_new(int argc, VALUE *argv, VALUE self) {
                 oj_set_parser_saj(p);
             } else if (0 == strcmp("validate", ms)) {
                 oj_set_parser_validator(p);
+            } else if (0 == strcmp("tape", ms)) {
+                oj_set_parser_tape(p);
             } else if (0 == strcmp("debug", ms)) {
                 oj_set_parser_debug(p);
             } else {
-                rb_raise(rb_eArgError, "mode must be :validate, :usual, :saj, or :object");
+                rb_raise(rb_eArgError, "mode must be :validate, :usual, :saj, :tape, or :object");
             }
         }
         if (1 < argc) {
@@ -1375,10 +1636,18 @@ void oj_parser_set_option(ojParser p, VALUE ropts) {
  * - *:validate*
  *   - no options
  *
+ * - *:tape*
+ *   - no options
+ *
  * - *:saj*
+ *   - _batch_ is the number of events passed at a time to the add_events method of a handler that
+ *     has one. Events are a flat Array of event, key, and value triples and are also passed when
+ *     a top level value ends. A handler batch_events method can return the events wanted.
  *   - _cache_keys_ is a flag indicating hash keys should be cached.
  *   - _cache_strings_ is a positive integer less than 35. Strings shorter than that length are cached.
  *   - _handler_ is the SAJ handler
+ *   - _only_ is an Array of JSON Pointer paths, the same as for the usual delegate. Only values on a
+ *     path and everything in them make events. Arrays and objects off every path are skipped.
  *
  * - *:usual*
  *   - _cache_keys_ is a flag indicating hash keys should be cached.
@@ -1394,6 +1663,9 @@ void oj_parser_set_option(ojParser p, VALUE ropts) {
  *     the decimals with significant digits are 16 or less are Floats and long
  *     ones are BigDecimal. _:ruby_ uses a call to Ruby to convert a string to a Float.
  *     _:float_ always generates a Float. _:bigdecimal_ always results in a BigDecimal.
+ *   - _each_element_ is true for the members of a top level array or an Array of JSON Pointer
+ *     paths. Each value on a path is yielded to the block given to parse or load as soon as it
+ *     is complete and then dropped, so a long array of records is parsed in constant memory.
  *   - _ignore_json_create_ is a flag that when set the class json_create method is
  *     ignored on parsing in favor of creating an instance and populating directly.
  *   - _missing_class_ is an indicator that determines how unknown class names are handled.
@@ -1401,8 +1673,22 @@ void oj_parser_set_option(ojParser p, VALUE ropts) {
  *     and continues as a Hash (default), and :raise which raises an exception if the class is not found.
  *   - _omit_null_ is a flag that if true then null values in a map or object are omitted
  *     from the resulting Hash or Object.
+ *   - _only_ is an Array of JSON Pointer paths such as "/meta/cursor" where a * segment matches any
+ *     member. Only values on one of the paths are built and arrays and objects off every
+ *     path are skipped without being fully checked. A nil value turns the filter off.
+ *   - _struct_class_ is a Hash of JSON Pointer paths, with the same * segments as _only_, to Struct or
+ *     Data classes. Objects on a path are built by passing the member values to new in member
+ *     order without making a Hash first. Keys that are not members are ignored.
  *   - _symbol_keys_ is a flag that indicates Hash keys should be parsed to Symbols versus Strings.
  */
+// A parser that is parsing without the GVL is still in use when another
+// thread calls one of its methods.
+static void parser_check_idle(ojParser p) {
+    if (NULL != p->no_gvl) {
+        rb_raise(rb_eRuntimeError, "the parser is in use by another thread");
+    }
+}
+
 static VALUE parser_missing(int argc, VALUE *argv, VALUE self) {
     ojParser       p;
     const char    *key  = NULL;
@@ -1410,6 +1696,7 @@ static VALUE parser_missing(int argc, VALUE *argv, VALUE self) {
     volatile VALUE rv   = Qnil;
 
     TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+    parser_check_idle(p);
 
 #if HAVE_RB_EXT_RACTOR_SAFE
     // This doesn't seem to do anything.
@@ -1441,6 +1728,9 @@ static void validate_primitives_are_complete(ojParser p) {
 }
 
 static void validate_non_primitives_are_complete(ojParser p) {
+    if (0 < p->skip) {
+        parse_error(p, "skipped container is not closed");
+    }
     if (0 >= p->depth) {
         return;
     }
@@ -1456,6 +1746,64 @@ static void validate_document_end(ojParser p) {
     validate_non_primitives_are_complete(p);
 }
 
+#if HAVE_RB_THREAD_CALL_WITHOUT_GVL
+static void *parse_no_gvl(void *x) {
+    struct _noGvl *ng = (struct _noGvl *)x;
+
+    if (0 == setjmp(ng->jmp)) {
+        parse(ng->p, ng->json, ng->len, false);
+        validate_document_end(ng->p);
+    }
+    return NULL;
+}
+
+static VALUE parse_no_gvl_call(VALUE x) {
+    rb_thread_call_without_gvl(parse_no_gvl, (void *)x, NULL, NULL);
+
+    return Qnil;
+}
+
+static VALUE parse_no_gvl_done(VALUE x) {
+    ((struct _noGvl *)x)->p->no_gvl = NULL;
+
+    return Qnil;
+}
+
+// Parses with the GVL released. Other threads run in the meantime so the
+// parser is marked busy with the no_gvl member until the parse is done and
+// parser_check_idle() stops another thread from starting on it. The only
+// thing that can happen in the delegate is growth of the key and string
+// buffers and xmalloc can be called without the GVL.
+static void parse_without_gvl(ojParser p, const byte *json, size_t len) {
+    struct _noGvl ng;
+
+    ng.p      = p;
+    ng.json   = json;
+    ng.len    = len;
+    *ng.msg   = '\0';
+    p->no_gvl = &ng;
+    rb_ensure(parse_no_gvl_call, (VALUE)&ng, parse_no_gvl_done, (VALUE)&ng);
+
+    if ('\0' != *ng.msg) {
+        rb_raise(oj_json_parser_error_class, "%s", ng.msg);
+    }
+}
+#endif
+
+// Parses a complete, NUL terminated document that is already in memory.
+static VALUE parse_whole(ojParser p, const byte *json, size_t len) {
+#if HAVE_RB_THREAD_CALL_WITHOUT_GVL
+    if (p->gvl_free && GVL_FREE_MIN_LEN <= len) {
+        parse_without_gvl(p, json, len);
+        return p->result(p);
+    }
+#endif
+    parse(p, json, len, false);
+    validate_document_end(p);
+
+    return p->result(p);
+}
+
 /* Document-method: parse(json)
  * call-seq: parse(json)
  *
@@ -1474,13 +1822,12 @@ static VALUE parser_parse(VALUE self, VALUE json) {
     ptr = (const byte *)StringValuePtr(json);
 
     TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+    parser_check_idle(p);
 
     parser_reset(p);
     p->start(p);
-    parse(p, ptr, (size_t)RSTRING_LEN(json), false);
-    validate_document_end(p);
 
-    return p->result(p);
+    return parse_whole(p, ptr, (size_t)RSTRING_LEN(json));
 }
 
 static VALUE load_rescue(VALUE self, VALUE x) {
@@ -1501,7 +1848,8 @@ static VALUE load(VALUE self) {
             parse(p, (byte *)StringValuePtr(rbuf), (size_t)RSTRING_LEN(rbuf), true);
         }
         if (Qtrue == rb_funcall(p->reader, oj_eofq_id, 0)) {
-            if (0 < p->depth) {
+            close_top_num(p);
+            if (0 < p->depth || 0 < p->skip) {
                 parse_error(p, "parse error, not closed");
             }
             break;
@@ -1510,10 +1858,94 @@ static VALUE load(VALUE self) {
     return Qtrue;
 }
 
+#if !IS_WINDOWS
+struct _fdLoad {
+    ojParser p;
+    int      fd;
+    int      err;
+    byte    *buf;
+    size_t   cap;
+    ssize_t  cnt;
+};
+
+static void *fd_read(void *x) {
+    struct _fdLoad *fl = (struct _fdLoad *)x;
+
+    fl->cnt = read(fl->fd, fl->buf, fl->cap);
+    fl->err = errno;
+
+    return NULL;
+}
+
+// Reads the file descriptor of an IO directly into a buffer that grows while
+// reads keep filling it. The read is made without the GVL so a pipe or socket
+// that is slow to deliver does not hold up other threads.
+static VALUE fd_load(VALUE x) {
+    struct _fdLoad *fl = (struct _fdLoad *)x;
+    ojParser        p  = fl->p;
+
+    p->start(p);
+    while (true) {
+#if HAVE_RB_THREAD_CALL_WITHOUT_GVL
+        rb_thread_call_without_gvl(fd_read, fl, RUBY_UBF_IO, NULL);
+#else
+        fd_read(fl);
+#endif
+        if (fl->cnt < 0) {
+            // Waits on EAGAIN and checks for interrupts on EINTR.
+            errno = fl->err;
+            if (rb_io_wait_readable(fl->fd)) {
+                continue;
+            }
+            rb_raise(rb_eIOError, "error reading from IO: %s", strerror(fl->err));
+        }
+        if (0 == fl->cnt) {
+            break;
+        }
+        fl->buf[fl->cnt] = '\0';
+        parse(p, fl->buf, fl->cnt, true);
+        if ((size_t)fl->cnt == fl->cap && fl->cap < LOAD_BUF_MAX) {
+            fl->cap *= 2;
+            OJ_R_REALLOC_N(fl->buf, byte, fl->cap + 1);
+        }
+    }
+    close_top_num(p);
+    if (0 < p->depth || 0 < p->skip) {
+        parse_error(p, "parse error, not closed");
+    }
+    return Qtrue;
+}
+
+static VALUE fd_load_cleanup(VALUE x) {
+    OJ_R_FREE(((struct _fdLoad *)x)->buf);
+
+    return Qnil;
+}
+
+// Returns the file descriptor of an IO that can be read directly or -1. Data
+// already in the read buffer of the IO would be skipped by reading the
+// descriptor so such an IO is read with readpartial.
+static int load_fd(VALUE reader) {
+    rb_io_t *fptr;
+
+    if (!RB_TYPE_P(reader, T_FILE)) {
+        return -1;
+    }
+    GetOpenFile(reader, fptr);
+    rb_io_check_readable(fptr);
+    if (0 != rb_io_read_pending(fptr)) {
+        return -1;
+    }
+    return FIX2INT(rb_funcall(reader, oj_fileno_id, 0));
+}
+#endif
+
 /* Document-method: load(reader)
  * call-seq: load(reader)
  *
- * Parse a JSON stream.
+ * Parse a JSON stream. An IO such as a File, pipe, or socket is read directly
+ * from its file descriptor. Any other reader must respond to _readpartial_
+ * and _eof?_.
  *
  * Returns the result according to the delegate of the parser.
  */
@@ -1521,10 +1953,26 @@ static VALUE parser_load(VALUE self, VALUE reader) {
     ojParser p;
 
     TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+    parser_check_idle(p);
 
     parser_reset(p);
     p->reader = reader;
+#if !IS_WINDOWS
+    {
+        struct _fdLoad fl;
+
+        if (0 <= (fl.fd = load_fd(reader))) {
+            fl.p   = p;
+            fl.cap = LOAD_BUF_MIN;
+            fl.buf = OJ_R_ALLOC_N(byte, fl.cap + 1);
+            rb_ensure(fd_load, (VALUE)&fl, fd_load_cleanup, (VALUE)&fl);
+
+            return p->result(p);
+        }
+    }
+#endif
     rb_rescue2(load, self, load_rescue, Qnil, rb_eEOFError, 0);
+    close_top_num(p);
 
     return p->result(p);
 }
@@ -1533,14 +1981,52 @@ struct _fileParse {
     ojParser    p;
     const char *path;
     int         fd;
+    byte       *map;
+    size_t      map_len;
+    size_t      size;
 };
 
+#if USE_MMAP
+// Maps a regular file so it can be parsed in one pass. parse() expects a NUL
+// terminated document so an anonymous zeroed region a page longer than the
+// file is reserved first and the file is mapped over the front of it. That
+// leaves at least one zero byte after the content even when the file size is
+// a multiple of the page size.
+static bool file_map(struct _fileParse *fp, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t len  = (size / page + 1) * page;
+    void  *addr;
+
+    if (MAP_FAILED == (addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0))) {
+        return false;
+    }
+    if (MAP_FAILED == mmap(addr, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fp->fd, 0)) {
+        munmap(addr, len);
+        return false;
+    }
+#if HAVE_POSIX_FADVISE
+    posix_fadvise(fp->fd, 0, (off_t)size, POSIX_FADV_SEQUENTIAL);
+#endif
+#if HAVE_MADVISE
+    madvise(addr, size, MADV_SEQUENTIAL);
+#endif
+    fp->map     = (byte *)addr;
+    fp->map_len = len;
+    fp->size    = size;
+
+    return true;
+}
+#endif
+
 static VALUE file_parse(VALUE x) {
     struct _fileParse *fp = (struct _fileParse *)x;
     byte               buf[16385];
     size_t             size = sizeof(buf) - 1;
     ssize_t            rsize;
 
+    if (NULL != fp->map) {
+        return parse_whole(fp->p, fp->map, fp->size);
+    }
     while (true) {
         if (0 > (rsize = read(fp->fd, buf, size))) {
             rb_raise(rb_eIOError, "error reading from %s", fp->path);
@@ -1551,13 +2037,21 @@ static VALUE file_parse(VALUE x) {
         buf[rsize] = '\0';
         parse(fp->p, buf, rsize, true);
     }
+    close_top_num(fp->p);
     validate_document_end(fp->p);
 
     return fp->p->result(fp->p);
 }
 
 static VALUE file_close(VALUE x) {
-    close(((struct _fileParse *)x)->fd);
+    struct _fileParse *fp = (struct _fileParse *)x;
+
+#if USE_MMAP
+    if (NULL != fp->map) {
+        munmap(fp->map, fp->map_len);
+    }
+#endif
+    close(fp->fd);
 
     return Qnil;
 }
@@ -1565,7 +2059,8 @@ static VALUE file_close(VALUE x) {
 /* Document-method: file(filename)
  * call-seq: file(filename)
  *
- * Parse a JSON file.
+ * Parse a JSON file. Regular files are memory mapped and parsed in a single
+ * pass while pipes and other special files are read in chunks.
  *
  * Returns the result according to the delegate of the parser.
  */
@@ -1576,6 +2071,7 @@ static VALUE parser_file(VALUE self, VALUE filename) {
     int               fd;
 
     TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+    parser_check_idle(p);
 
     path = StringValuePtr(filename);
 
@@ -1596,13 +2092,781 @@ static VALUE parser_file(VALUE self, VALUE filename) {
         return p->result(p);
     }
 #endif
-    fp.p    = p;
-    fp.path = path;
-    fp.fd   = fd;
+    fp.p       = p;
+    fp.path    = path;
+    fp.fd      = fd;
+    fp.map     = NULL;
+    fp.map_len = 0;
+    fp.size    = 0;
+#if USE_MMAP
+    {
+        struct stat st;
+
+        if (0 == fstat(fd, &st) && S_ISREG(st.st_mode) && 0 < st.st_size && (uint64_t)st.st_size < (uint64_t)SIZE_MAX) {
+            file_map(&fp, (size_t)st.st_size);
+        }
+    }
+#endif
 
     return rb_ensure(file_parse, (VALUE)&fp, file_close, (VALUE)&fp);
 }
 
+// Newline delimited JSON is parsed in two steps. Worker threads split their
+// slice of the input into lines, parse each line without the GVL, and record
+// the delegate calls the parse makes as a flat list of events with the
+// strings, keys, and numbers already decoded. The calling thread then replays
+// those events, line by line and in order, into the parser's own delegate
+// which is the only part that needs the GVL.
+
+// Slices are at least this large so short inputs do not pay for threads.
+#define LINES_SLICE_MIN 65536
+// Bytes read from an IO for each thread per chunk.
+#define LINES_READ_SIZE (1 << 20)
+
+typedef struct _lineEvent {
+    long   cur;
+    size_t soff;  // string or big number in the slice arena
+    size_t slen;
+    size_t koff;  // key in the slice arena if the parent is an object
+    size_t klen;
+    union {
+        int64_t fixnum;
+        double  dub;
+    };
+    char kind;  // ojType for values, the bracket for an open or close
+} *LineEvent;
+
+typedef struct _lineRec {
+    size_t first;  // index of the first event
+    size_t cnt;
+    long   line;  // zero based in the slice
+} *LineRec;
+
+typedef struct _lineSlice {
+    char         *buf;  // the slice with each newline replaced by a NUL
+    size_t        len;
+    ojParser      w;  // recording parser private to the slice
+    LineEvent     events;
+    size_t        ecnt;
+    size_t        ecap;
+    char         *arena;
+    size_t        alen;
+    size_t        acap;
+    LineRec       recs;
+    size_t        rcnt;
+    size_t        rcap;
+    long          lines;     // lines in the slice
+    long          err_line;  // -1 unless a line failed
+    long          indent;    // white space before the line's document
+    struct _noGvl ng;
+} *LineSlice;
+
+static void *lines_grow(ojParser p, void *ptr, size_t *cap, size_t need, size_t size) {
+    size_t cnt = *cap * 2;
+
+    if (cnt < need) {
+        cnt = need + 1024;
+    }
+    if (NULL == (ptr = OJ_REALLOC(ptr, cnt * size))) {
+        parse_error(p, "out of memory");
+    }
+    *cap = cnt;
+
+    return ptr;
+}
+
+static size_t lines_arena_add(ojParser p, Buf b) {
+    LineSlice s   = (LineSlice)p->ctx;
+    size_t    len = buf_len(b);
+    size_t    off = s->alen;
+
+    if (s->acap < s->alen + len) {
+        s->arena = lines_grow(p, s->arena, &s->acap, s->alen + len, 1);
+    }
+    memcpy(s->arena + s->alen, b->head, len);
+    s->alen += len;
+
+    return off;
+}
+
+static LineEvent lines_event(ojParser p, char kind) {
+    LineSlice s = (LineSlice)p->ctx;
+    LineEvent e;
+
+    if (s->ecap <= s->ecnt) {
+        s->events = lines_grow(p, s->events, &s->ecap, s->ecnt + 1, sizeof(struct _lineEvent));
+    }
+    e       = s->events + s->ecnt++;
+    e->kind = kind;
+    e->cur  = p->cur + s->indent;
+    e->klen = 0;
+    if (']' != kind && '}' != kind && OBJECT_FUN == p->stack[p->depth]) {
+        e->klen = buf_len(&p->key);
+        e->koff = lines_arena_add(p, &p->key);
+    }
+    return e;
+}
+
+static void lines_add_null(ojParser p) {
+    lines_event(p, OJ_NULL);
+}
+
+static void lines_add_true(ojParser p) {
+    lines_event(p, OJ_TRUE);
+}
+
+static void lines_add_false(ojParser p) {
+    lines_event(p, OJ_FALSE);
+}
+
+static void lines_add_int(ojParser p) {
+    lines_event(p, OJ_INT)->fixnum = p->num.fixnum;
+}
+
+static void lines_add_float(ojParser p) {
+    lines_event(p, OJ_DECIMAL)->dub = (double)p->num.dub;
+}
+
+static void lines_add_big(ojParser p) {
+    LineEvent e = lines_event(p, OJ_BIG);
+
+    e->slen = buf_len(&p->buf);
+    e->soff = lines_arena_add(p, &p->buf);
+}
+
+static void lines_add_str(ojParser p) {
+    LineEvent e = lines_event(p, OJ_STRING);
+
+    e->slen = buf_len(&p->buf);
+    e->soff = lines_arena_add(p, &p->buf);
+}
+
+static void lines_open_array(ojParser p) {
+    lines_event(p, '[');
+}
+
+static void lines_close_array(ojParser p) {
+    lines_event(p, ']');
+}
+
+static void lines_open_object(ojParser p) {
+    lines_event(p, '{');
+}
+
+static void lines_close_object(ojParser p) {
+    lines_event(p, '}');
+}
+
+static void lines_noop(ojParser p) {
+}
+
+// Kept apart from the loop in lines_scan() so nothing there can be clobbered
+// by the longjmp() from parse_error().
+static bool lines_parse_one(LineSlice s, const char *line, size_t len) {
+    if (0 != setjmp(s->ng.jmp)) {
+        return false;
+    }
+    parser_reset(s->w);
+    parse(s->w, (const byte *)line, len, false);
+    validate_document_end(s->w);
+
+    return true;
+}
+
+static void *lines_scan(void *x) {
+    LineSlice   s   = (LineSlice)x;
+    const char *end = s->buf + s->len;
+    char       *b   = s->buf;
+    char       *e;
+    const char *v;
+    LineRec     r;
+
+    s->w->no_gvl = &s->ng;
+    for (s->lines = 0; b < end; s->lines++, b = e + 1) {
+        if (NULL == (e = memchr(b, '\n', end - b))) {
+            e = (char *)end;
+        } else {
+            *e = '\0';
+        }
+        for (v = b; ' ' == *v || '\t' == *v || '\r' == *v; v++) {
+        }
+        if (e <= v) {
+            continue;
+        }
+        if (s->rcap <= s->rcnt) {
+            if (NULL == (s->recs = OJ_REALLOC(s->recs, sizeof(struct _lineRec) * (s->rcap * 2 + 64)))) {
+                snprintf(s->ng.msg, sizeof(s->ng.msg), "out of memory");
+                s->err_line = s->lines;
+                return NULL;
+            }
+            s->rcap = s->rcap * 2 + 64;
+        }
+        r        = s->recs + s->rcnt++;
+        r->first = s->ecnt;
+        r->line  = s->lines;
+        // The just_one parser would take leading white space as the end of
+        // the document so the parse starts at the value.
+        s->indent = v - b;
+        if (!lines_parse_one(s, v, e - v)) {
+            s->err_line = r->line;
+            return NULL;
+        }
+        r->cnt = s->ecnt - r->first;
+    }
+    return NULL;
+}
+
+static VALUE lines_thread(void *x) {
+#if HAVE_RB_THREAD_CALL_WITHOUT_GVL
+    rb_thread_call_without_gvl(lines_scan, x, NULL, NULL);
+#else
+    lines_scan(x);
+#endif
+    return Qnil;
+}
+
+static void lines_set_key(ojParser p, LineSlice s, LineEvent e) {
+    if (OBJECT_FUN == p->stack[p->depth]) {
+        buf_reset(&p->key);
+        buf_append_string(&p->key, s->arena + e->koff, e->klen);
+    }
+}
+
+// Returns the close event of a container the delegate asked to skip.
+static LineEvent lines_skip(ojParser p, LineEvent e, LineEvent end) {
+    for (e++; e < end; e++) {
+        switch (e->kind) {
+        case '{':
+        case '[': p->skip++; break;
+        case '}':
+        case ']':
+            if (0 == --p->skip) {
+                return e;
+            }
+            break;
+        default: break;
+        }
+    }
+    p->skip = 0;
+
+    return e;
+}
+
+// Replays the events of one line into the delegate just as parse() would
+// have made the calls. The line is the one in the whole input so a delegate
+// that reports locations sees the same line and column as when the input is
+// parsed with parse().
+static VALUE lines_replay(ojParser p, LineSlice s, LineRec r, long line) {
+    LineEvent e   = s->events + r->first;
+    LineEvent end = e + r->cnt;
+
+    parser_reset(p);
+    p->start(p);
+    p->line = line;
+    p->col  = -1;
+    for (; e < end; e++) {
+        p->cur = e->cur;
+        switch (e->kind) {
+        case '{':
+            lines_set_key(p, s, e);
+            p->funcs[p->stack[p->depth]].open_object(p);
+            if (0 < p->skip) {
+                e = lines_skip(p, e, end);
+                break;
+            }
+            p->depth++;
+            p->stack[p->depth] = OBJECT_FUN;
+            break;
+        case '}':
+            p->depth--;
+            p->funcs[p->stack[p->depth]].close_object(p);
+            break;
+        case '[':
+            lines_set_key(p, s, e);
+            p->funcs[p->stack[p->depth]].open_array(p);
+            if (0 < p->skip) {
+                e = lines_skip(p, e, end);
+                break;
+            }
+            p->depth++;
+            p->stack[p->depth] = ARRAY_FUN;
+            break;
+        case ']':
+            p->depth--;
+            p->funcs[p->stack[p->depth]].close_array(p);
+            break;
+        case OJ_NULL:
+            lines_set_key(p, s, e);
+            p->funcs[p->stack[p->depth]].add_null(p);
+            break;
+        case OJ_TRUE:
+            lines_set_key(p, s, e);
+            p->funcs[p->stack[p->depth]].add_true(p);
+            break;
+        case OJ_FALSE:
+            lines_set_key(p, s, e);
+            p->funcs[p->stack[p->depth]].add_false(p);
+            break;
+        case OJ_INT:
+            lines_set_key(p, s, e);
+            p->num.fixnum = e->fixnum;
+            p->funcs[p->stack[p->depth]].add_int(p);
+            break;
+        case OJ_DECIMAL:
+            lines_set_key(p, s, e);
+            p->num.dub = e->dub;
+            p->funcs[p->stack[p->depth]].add_float(p);
+            break;
+        case OJ_BIG:
+            lines_set_key(p, s, e);
+            buf_reset(&p->buf);
+            buf_append_string(&p->buf, s->arena + e->soff, e->slen);
+            p->funcs[p->stack[p->depth]].add_big(p);
+            break;
+        case OJ_STRING:
+            lines_set_key(p, s, e);
+            if (p->str_direct) {
+                p->str     = s->arena + e->soff;
+                p->str_len = e->slen;
+            } else {
+                buf_reset(&p->buf);
+                buf_append_string(&p->buf, s->arena + e->soff, e->slen);
+            }
+            p->funcs[p->stack[p->depth]].add_str(p);
+            break;
+        default: break;
+        }
+    }
+    return p->result(p);
+}
+
+typedef struct _lines {
+    ojParser    p;
+    VALUE       result;  // Qnil when yielding
+    VALUE       threads;
+    long        line;  // lines before the current chunk
+    int         max;   // most threads to use
+    int         cnt;   // slices in the current chunk
+    LineSlice   slices;
+    const char *data;  // the current chunk
+    size_t      len;
+} *Lines;
+
+static void lines_slice_init(LineSlice s, const char *src, size_t len) {
+    Funcs    end = NULL;
+    Funcs    f;
+    ojParser w;
+
+    memset(s, 0, sizeof(struct _lineSlice));
+    s->err_line = -1;
+    s->len      = len;
+    s->buf      = OJ_R_ALLOC_N(char, len + 1);
+    memcpy(s->buf, src, len);
+    s->buf[len] = '\0';
+
+    w = OJ_R_ALLOC(struct _ojParser);
+    memset(w, 0, sizeof(struct _ojParser));
+    buf_init(&w->key);
+    buf_init(&w->buf);
+    w->map      = value_map;
+    w->just_one = true;
+    w->ctx      = s;
+    w->start    = lines_noop;
+    for (f = w->funcs, end = w->funcs + 3; f < end; f++) {
+        f->add_null     = lines_add_null;
+        f->add_true     = lines_add_true;
+        f->add_false    = lines_add_false;
+        f->add_int      = lines_add_int;
+        f->add_float    = lines_add_float;
+        f->add_big      = lines_add_big;
+        f->add_str      = lines_add_str;
+        f->open_array   = lines_open_array;
+        f->close_array  = lines_close_array;
+        f->open_object  = lines_open_object;
+        f->close_object = lines_close_object;
+    }
+    s->w = w;
+}
+
+static void lines_slice_cleanup(LineSlice s) {
+    if (NULL != s->w) {
+        buf_cleanup(&s->w->key);
+        buf_cleanup(&s->w->buf);
+        OJ_R_FREE(s->w);
+    }
+    OJ_R_FREE(s->buf);
+    OJ_FREE(s->events);
+    OJ_FREE(s->arena);
+    OJ_FREE(s->recs);
+}
+
+static VALUE lines_join(Lines ls, int i) {
+    VALUE t = rb_ary_entry(ls->threads, i);
+
+    if (Qnil != t) {
+        rb_ary_store(ls->threads, i, Qnil);
+        rb_funcall(t, rb_intern("join"), 0);
+    }
+    return Qnil;
+}
+
+static VALUE lines_chunk_materialize(VALUE x) {
+    Lines ls = (Lines)x;
+    int   i;
+
+    for (i = 0; i < ls->cnt; i++) {
+        LineSlice s = ls->slices + i;
+        LineRec   r;
+        LineRec   rend;
+
+        lines_join(ls, i);
+        for (r = s->recs, rend = r + s->rcnt; r < rend; r++) {
+            volatile VALUE v;
+
+            if (r->line == s->err_line) {
+                rb_raise(oj_json_parser_error_class, "%s on line %ld", s->ng.msg, ls->line + r->line + 1);
+            }
+            v = lines_replay(ls->p, s, r, ls->line + r->line + 1);
+            if (Qnil == ls->result) {
+                rb_yield(v);
+            } else {
+                rb_ary_push(ls->result, v);
+            }
+        }
+        if (0 <= s->err_line) {  // out of memory before the line was recorded
+            rb_raise(oj_json_parser_error_class, "%s on line %ld", s->ng.msg, ls->line + s->err_line + 1);
+        }
+        ls->line += s->lines;
+    }
+    return Qnil;
+}
+
+static VALUE lines_chunk_cleanup(VALUE x) {
+    Lines ls = (Lines)x;
+    int   i;
+
+    // The workers must be done with the slices before they are freed.
+    for (i = 0; i < ls->cnt; i++) {
+        lines_join(ls, i);
+    }
+    for (i = 0; i < ls->cnt; i++) {
+        lines_slice_cleanup(ls->slices + i);
+    }
+    OJ_R_FREE(ls->slices);
+    ls->slices      = NULL;
+    ls->cnt         = 0;
+    ls->p->no_yield = false;
+
+    return Qnil;
+}
+
+// Splits the chunk at newlines into a slice for each thread, starts the
+// workers, and replays the lines in order as each slice completes.
+static VALUE lines_chunk_run(VALUE x) {
+    Lines       ls   = (Lines)x;
+    const char *data = ls->data;
+    size_t      len  = ls->len;
+    const char *end  = data + len;
+    const char *s    = data;
+    const char *e;
+    int         cnt = ls->max;
+    int         i;
+
+    if ((size_t)cnt > len / LINES_SLICE_MIN + 1) {
+        cnt = (int)(len / LINES_SLICE_MIN + 1);
+    }
+    ls->slices = OJ_R_ALLOC_N(struct _lineSlice, cnt);
+    for (i = 0; i < cnt && s < end; i++) {
+        if (i == cnt - 1 || NULL == (e = memchr(data + len * (i + 1) / cnt, '\n', end - (data + len * (i + 1) / cnt)))) {
+            e = end;
+        } else {
+            e++;
+        }
+        if (e < s) {
+            continue;
+        }
+        // Counted first so the cleanup frees a slice that fails part way.
+        ls->cnt++;
+        lines_slice_init(ls->slices + ls->cnt - 1, s, e - s);
+        s = e;
+    }
+    for (i = 0; i < ls->cnt; i++) {
+        rb_ary_push(ls->threads, (1 == ls->cnt) ? Qnil : rb_thread_create(lines_thread, ls->slices + i));
+    }
+    if (1 == ls->cnt) {
+        lines_thread(ls->slices);
+    }
+    // Each line is a separate document and parse_lines yields the results
+    // itself so the delegate must not yield values to the block as well.
+    ls->p->no_yield = true;
+
+    return lines_chunk_materialize(x);
+}
+
+static void lines_chunk(Lines ls, const char *data, size_t len) {
+    ls->data   = data;
+    ls->len    = len;
+    ls->slices = NULL;
+    ls->cnt    = 0;
+    rb_ary_clear(ls->threads);
+    rb_ensure(lines_chunk_run, (VALUE)ls, lines_chunk_cleanup, (VALUE)ls);
+}
+
+/* Document-method: parse_lines(input, threads: 1)
+ * call-seq: parse_lines(input, threads: 1) { |value| ... }
+ *
+ * Parse newline delimited JSON from a String or from an IO or anything else
+ * that responds to _read_. Each line must hold one JSON document and blank
+ * lines are skipped. Lines are parsed by up to _threads_ threads without the
+ * GVL and then handed to the delegate in their original order so the results
+ * are the same as parsing each line with _parse_.
+ *
+ * If a block is given each result is yielded to it, otherwise an Array of the
+ * results is returned. A line that is not valid JSON raises an error that
+ * includes the line number.
+ */
+static VALUE parser_parse_lines(int argc, VALUE *argv, VALUE self) {
+    struct _lines  ls;
+    VALUE          input;
+    VALUE          opts = Qnil;
+    volatile VALUE threads;
+    volatile VALUE result = Qnil;
+
+    TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, ls.p);
+    parser_check_idle(ls.p);
+
+    rb_scan_args(argc, argv, "1:", &input, &opts);
+    ls.max = 1;
+    if (Qnil != opts) {
+        VALUE v = rb_hash_aref(opts, ID2SYM(rb_intern("threads")));
+
+        if (Qnil != v) {
+            ls.max = NUM2INT(v);
+            if (ls.max < 1) {
+                rb_raise(rb_eArgError, "threads must be 1 or more");
+            }
+        }
+    }
+    if (!rb_block_given_p()) {
+        result = rb_ary_new();
+    }
+    threads    = rb_ary_new();
+    ls.result  = result;
+    ls.threads = threads;
+    ls.line    = 0;
+    ls.cnt     = 0;
+    ls.slices  = NULL;
+
+    if (RB_TYPE_P(input, T_STRING)) {
+        lines_chunk(&ls, RSTRING_PTR(input), (size_t)RSTRING_LEN(input));
+        RB_GC_GUARD(input);
+    } else {
+        volatile VALUE pending = rb_str_new2("");
+        volatile VALUE rsize   = LONG2NUM((long)ls.max * LINES_READ_SIZE);
+        volatile VALUE chunk;
+        ID             read_id = rb_intern("read");
+
+        while (Qnil != (chunk = rb_funcall(input, read_id, 1, rsize))) {
+            const char *head;
+            const char *nl;
+
+            rb_str_append(pending, StringValue(chunk));
+            head = RSTRING_PTR(pending);
+            // Only whole lines are parsed, the rest waits for the next read.
+            for (nl = head + RSTRING_LEN(pending) - 1; head <= nl && '\n' != *nl; nl--) {
+            }
+            if (head <= nl) {
+                lines_chunk(&ls, head, nl - head + 1);
+                pending = rb_str_substr(pending, nl - head + 1, RSTRING_LEN(pending) - (nl - head + 1));
+            }
+        }
+        if (0 < RSTRING_LEN(pending)) {
+            lines_chunk(&ls, RSTRING_PTR(pending), (size_t)RSTRING_LEN(pending));
+        }
+    }
+    RB_GC_GUARD(threads);
+
+    return (Qnil == result) ? self : result;
+}
+
+// While a chunk is fed the top level functions of the delegate are wrapped
+// so the result of each document can be taken as soon as it is complete.
+struct _feed {
+    ojParser       p;
+    VALUE          chunk;  // Qnil for finish
+    struct _funcs  top;
+    volatile VALUE docs;  // Qnil when a block is given
+    bool           no_yield;
+    bool           done;
+};
+
+static void feed_doc(ojParser p) {
+    struct _feed  *f   = p->feed;
+    volatile VALUE doc = p->result(p);
+
+    p->start(p);
+    if (Qnil == f->docs) {
+        rb_yield(doc);
+    } else {
+        rb_ary_push(f->docs, doc);
+    }
+}
+
+#define FEED_ADD(name)                    \
+    static void feed_##name(ojParser p) { \
+        p->feed->top.name(p);             \
+        feed_doc(p);                      \
+    }
+
+FEED_ADD(add_null)
+FEED_ADD(add_true)
+FEED_ADD(add_false)
+FEED_ADD(add_int)
+FEED_ADD(add_float)
+FEED_ADD(add_big)
+FEED_ADD(add_str)
+FEED_ADD(close_array)
+FEED_ADD(close_object)
+
+static VALUE feed_parse(VALUE x) {
+    struct _feed *f = (struct _feed *)x;
+    ojParser      p = f->p;
+
+    if (Qnil == f->chunk) {
+        close_top_num(p);
+        validate_document_end(p);
+        if (value_map != p->map) {
+            parse_error(p, "incomplete JSON document");
+        }
+    } else {
+        parse(p, (const byte *)RSTRING_PTR(f->chunk), (size_t)RSTRING_LEN(f->chunk), true);
+    }
+    f->done = true;
+
+    return Qnil;
+}
+
+static VALUE feed_cleanup(VALUE x) {
+    struct _feed *f = (struct _feed *)x;
+    ojParser      p = f->p;
+
+    p->funcs[TOP_FUN] = f->top;
+    p->no_yield       = f->no_yield;
+    p->feed           = NULL;
+    if (Qnil != f->chunk) {
+        rb_str_unlocktmp(f->chunk);
+    }
+    // A chunk that was not parsed to the end leaves the parser in an unknown
+    // state so the next feed starts over.
+    if (!f->done) {
+        p->feeding = false;
+    }
+    return Qnil;
+}
+
+static VALUE feed(VALUE self, VALUE chunk) {
+    ojParser     p;
+    struct _feed f;
+    Funcs        top;
+
+    TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+    parser_check_idle(p);
+
+    if (NULL != p->feed) {
+        rb_raise(rb_eRuntimeError, "the parser is already parsing a fed chunk");
+    }
+    if (!p->feeding) {
+        parser_reset(p);
+        p->start(p);
+        p->feeding = true;
+    }
+    f.p        = p;
+    f.chunk    = chunk;
+    f.top      = p->funcs[TOP_FUN];
+    f.docs     = rb_block_given_p() ? Qnil : rb_ary_new();
+    f.no_yield = p->no_yield;
+    f.done     = false;
+
+    top               = &p->funcs[TOP_FUN];
+    top->add_null     = feed_add_null;
+    top->add_true     = feed_add_true;
+    top->add_false    = feed_add_false;
+    top->add_int      = feed_add_int;
+    top->add_float    = feed_add_float;
+    top->add_big      = feed_add_big;
+    top->add_str      = feed_add_str;
+    top->close_array  = feed_close_array;
+    top->close_object = feed_close_object;
+    // Documents are handed out by feed_doc, not by the delegate.
+    p->no_yield = true;
+    p->feed     = &f;
+    if (Qnil != chunk) {
+        rb_str_locktmp(chunk);
+    }
+    rb_ensure(feed_parse, (VALUE)&f, feed_cleanup, (VALUE)&f);
+
+    return (Qnil == f.docs) ? self : f.docs;
+}
+
+/* Document-method: feed(chunk)
+ * call-seq: feed(chunk) { |value| ... }
+ *
+ * Parse the next chunk of a stream of JSON documents such as the data read
+ * from a socket. A document may be split across any number of chunks and
+ * the parser keeps its state between calls until _finish_ is called.
+ *
+ * If a block is given the result of each document completed by the chunk is
+ * yielded to it, otherwise an Array of those results is returned. A number
+ * at the end of a chunk is not complete until a following byte or _finish_
+ * ends it.
+ */
+static VALUE parser_feed(VALUE self, VALUE chunk) {
+    return feed(self, StringValue(chunk));
+}
+
+/* Document-method: finish
+ * call-seq: finish { |value| ... }
+ *
+ * End a stream started with _feed_. A document still waiting on more input
+ * raises an error. Like _feed_ any document completed by the end of the
+ * stream is yielded or returned in an Array. The next _feed_ starts a new
+ * stream.
+ */
+static VALUE parser_finish(VALUE self) {
+    ojParser       p;
+    volatile VALUE docs;
+
+    TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+
+    if (!p->feeding) {
+        return rb_block_given_p() ? self : rb_ary_new();
+    }
+    docs       = feed(self, Qnil);
+    p->feeding = false;
+
+    return docs;
+}
+
+/* Document-method: gvl_free?
+ * call-seq: gvl_free?
+ *
+ * Returns true if the delegate never touches Ruby objects so large documents
+ * are parsed with the GVL released and other threads can run. The validate
+ * and tape delegates are GVL free except for the shared Oj::Parser.validate
+ * and Oj::Parser.tape parsers.
+ */
+static VALUE parser_gvl_free(VALUE self) {
+    ojParser p;
+
+    TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+
+#if HAVE_RB_THREAD_CALL_WITHOUT_GVL
+    return p->gvl_free ? Qtrue : Qfalse;
+#else
+    return Qfalse;
+#endif
+}
+
 /* Document-method: just_one
  * call-seq: just_one
  *
@@ -1628,6 +2892,7 @@ static VALUE parser_just_one_set(VALUE self, VALUE v) {
     ojParser p;
 
     TypedData_Get_Struct(self, struct _ojParser, &oj_parser_type, p);
+    parser_check_idle(p);
 
     p->just_one = (Qtrue == v);
 
@@ -1685,7 +2950,8 @@ static VALUE validate_parser = Qundef;
 /* Document-method: validate
  * call-seq: validate
  *
- * Returns the default validate parser.
+ * Returns the default validate parser. It is shared so it holds the GVL while
+ * parsing, use Oj::Parser.new(:validate) for a parser that releases it.
  */
 static VALUE parser_validate(VALUE self) {
     if (Qundef == validate_parser) {
@@ -1696,12 +2962,38 @@ static VALUE parser_validate(VALUE self) {
         buf_init(&p->buf);
         p->map = value_map;
         oj_set_parser_validator(p);
+        p->gvl_free     = false;  // threads share this one
         validate_parser = TypedData_Wrap_Struct(parser_class, &oj_parser_type, p);
         rb_gc_register_address(&validate_parser);
     }
     return validate_parser;
 }
 
+static VALUE tape_parser = Qundef;
+
+/* Document-method: tape
+ * call-seq: tape
+ *
+ * Returns the default tape parser. Note the default tape parser can not be
+ * used concurrently in more than one thread. It is shared so it holds the GVL
+ * while parsing, use Oj::Parser.new(:tape) for a parser that releases it.
+ */
+static VALUE parser_tape(VALUE self) {
+    if (Qundef == tape_parser) {
+        ojParser p = OJ_R_ALLOC(struct _ojParser);
+
+        memset(p, 0, sizeof(struct _ojParser));
+        buf_init(&p->key);
+        buf_init(&p->buf);
+        p->map = value_map;
+        oj_set_parser_tape(p);
+        p->gvl_free = false;  // threads share this one
+        tape_parser = TypedData_Wrap_Struct(parser_class, &oj_parser_type, p);
+        rb_gc_register_address(&tape_parser);
+    }
+    return tape_parser;
+}
+
 static VALUE parser_safe(int argc, VALUE *argv, VALUE self) {
     VALUE options;
 
@@ -1740,6 +3032,24 @@ static VALUE parser_safe(int argc, VALUE *argv, VALUE self) {
  * forced to use the same options.
  */
 void oj_parser_init(void) {
+    switch (SIMD_Impl) {
+#ifdef HAVE_SIMD_AVX2
+    case SIMD_AVX512:
+    case SIMD_AVX2: scan_str_func = scan_str_avx2; break;
+#endif
+#ifdef HAVE_SIMD_SSE4_2
+    case SIMD_SSE42: scan_str_func = scan_str_sse42; break;
+#endif
+#ifdef HAVE_SIMD_SSE2
+    case SIMD_SSE2: scan_str_func = scan_str_sse2; break;
+#endif
+#ifdef HAVE_SIMD_NEON
+    case SIMD_NEON: scan_str_func = scan_str_neon; break;
+#endif
+    default: scan_str_func = scan_str; break;
+    }
+    oj_index_init();
+
     parser_class = rb_define_class_under(Oj, "Parser", rb_cObject);
     rb_gc_register_address(&parser_class);
     rb_undef_alloc_func(parser_class);
@@ -1748,6 +3058,10 @@ void oj_parser_init(void) {
     rb_define_method(parser_class, "parse", parser_parse, 1);
     rb_define_method(parser_class, "load", parser_load, 1);
     rb_define_method(parser_class, "file", parser_file, 1);
+    rb_define_method(parser_class, "parse_lines", parser_parse_lines, -1);
+    rb_define_method(parser_class, "feed", parser_feed, 1);
+    rb_define_method(parser_class, "finish", parser_finish, 0);
+    rb_define_method(parser_class, "gvl_free?", parser_gvl_free, 0);
     rb_define_method(parser_class, "just_one", parser_just_one, 0);
     rb_define_method(parser_class, "just_one=", parser_just_one_set, 1);
     rb_define_method(parser_class, "method_missing", parser_missing, -1);
@@ -1755,6 +3069,7 @@ void oj_parser_init(void) {
     rb_define_module_function(parser_class, "usual", parser_usual, 0);
     rb_define_module_function(parser_class, "saj", parser_saj, 0);
     rb_define_module_function(parser_class, "validate", parser_validate, 0);
+    rb_define_module_function(parser_class, "tape", parser_tape, 0);
     rb_define_module_function(parser_class, "safe", parser_safe, -1);
 
     oj_safe_init(parser_class);
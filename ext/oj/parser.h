@@ -34,7 +34,7 @@ typedef struct _num {
     uint32_t    len;
     int16_t     div;  // 10^div
     int16_t     exp;
-    uint8_t     shift;  // shift of fixnum to get decimal
+    uint32_t    shift;  // shift of fixnum to get decimal
     bool        neg;
     bool        exp_neg;
     // for numbers as strings, reuse buf
@@ -88,6 +88,26 @@ typedef struct _ojParser {
     uint32_t ucode;
     ojType   type;  // valType
     bool     just_one;
+    bool     gvl_free;  // set by delegates that never touch Ruby objects
+    bool     no_yield;  // set when delegates must not yield to a block
+    bool     feeding;   // between the first feed and finish
+
+    // A delegate that sets str_direct reads string values from str and
+    // str_len instead of buf. A string without escapes is then not copied
+    // into buf and str points at it in the input.
+    const char *str;
+    size_t      str_len;
+    bool        str_direct;
+
+    // A delegate sets skip to 1 in open_array or open_object to have the
+    // parser pass over the container without calling any more functions for
+    // it. The parser then uses it to count the brackets still open.
+    int  skip;
+    bool skip_str;  // in a string while skipping
+    bool skip_esc;  // the last byte skipped was a backslash in a string
+
+    struct _noGvl *no_gvl;  // set while parsing without the GVL
+    struct _feed  *feed;    // set while feed or finish is parsing
 } *ojParser;
 
 // Create a new parser without setting the delegate. The parser is
@@ -178,19 +178,72 @@ static void wrap_funcs(ojParser p, safe_T safe) {
     WRAP(f, add_str, safe_add_str_key, delegated_add_str_key_func);
 }
 
+#define UNWRAP(funcs, slot, wrapper, saved) \
+    do {                                    \
+        if (wrapper == (funcs)->slot) {     \
+            (funcs)->slot = safe->saved;    \
+        }                                   \
+    } while (0)
+
+// Puts the wrapped functions back so an option of the usual delegate that
+// wraps them itself, such as only, sees its own functions.
+static void unwrap_funcs(ojParser p, safe_T safe) {
+    Funcs f = &p->funcs[ARRAY_FUN];
+
+    UNWRAP(f, open_object, safe_open_object, delegated_open_object_func);
+    UNWRAP(f, open_array, safe_open_array, delegated_open_array_func);
+    UNWRAP(f, add_null, safe_add_null, delegated_add_null_func);
+    UNWRAP(f, add_true, safe_add_true, delegated_add_true_func);
+    UNWRAP(f, add_false, safe_add_false, delegated_add_false_func);
+    UNWRAP(f, add_int, safe_add_int, delegated_add_int_func);
+    UNWRAP(f, add_float, safe_add_float, delegated_add_float_func);
+    UNWRAP(f, add_big, safe_add_big, delegated_add_big_func);
+    UNWRAP(f, add_str, safe_add_str, delegated_add_str_func);
+
+    f = &p->funcs[OBJECT_FUN];
+    UNWRAP(f, open_object, safe_open_object_key, delegated_open_object_key_func);
+    UNWRAP(f, open_array, safe_open_array_key, delegated_open_array_key_func);
+    UNWRAP(f, add_null, safe_add_null_key, delegated_add_null_key_func);
+    UNWRAP(f, add_true, safe_add_true_key, delegated_add_true_key_func);
+    UNWRAP(f, add_false, safe_add_false_key, delegated_add_false_key_func);
+    UNWRAP(f, add_int, safe_add_int_key, delegated_add_int_key_func);
+    UNWRAP(f, add_float, safe_add_float_key, delegated_add_float_key_func);
+    UNWRAP(f, add_big, safe_add_big_key, delegated_add_big_key_func);
+    UNWRAP(f, add_str, safe_add_str_key, delegated_add_str_key_func);
+}
+
+struct _optionArgs {
+    ojParser    p;
+    const char *key;
+    VALUE       value;
+};
+
+static VALUE protect_option(VALUE x) {
+    struct _optionArgs *args = (struct _optionArgs *)x;
+    safe_T              safe = (safe_T)args->p->ctx;
+
+    return safe->delegated_option_func(args->p, args->key, args->value);
+}
+
 static VALUE safe_option(ojParser p, const char *key, VALUE value) {
-    safe_T safe = (safe_T)p->ctx;
-    VALUE  rv;
+    safe_T             safe = (safe_T)p->ctx;
+    struct _optionArgs args = {p, key, value};
+    VALUE              rv;
+    int                ex = 0;
 
     if (0 == strcmp("omit_null", key)) {
         return safe->omit_null ? Qtrue : Qfalse;
     }
-    rv = safe->delegated_option_func(p, key, value);
+    // The limits must be restored even if the delegate raises on the value.
+    unwrap_funcs(p, safe);
+    rv = rb_protect(protect_option, (VALUE)&args, &ex);
+    wrap_funcs(p, safe);
+    if (0 != ex) {
+        rb_jump_tag(ex);
+    }
     if (0 == strcmp("omit_null=", key)) {
         safe->omit_null = (Qtrue == rv);
     }
-    wrap_funcs(p, safe);
-
     return rv;
 }
 
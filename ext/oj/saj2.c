@@ -5,6 +5,7 @@
 #include "cache.h"
 #include "mem.h"
 #include "oj.h"
+#include "only.h"
 #include "parser.h"
 
 static VALUE get_key(ojParser p) {
@@ -354,6 +355,293 @@ static void add_str_key_loc(ojParser p) {
     rb_funcall(d->handler, oj_add_value_id, 4, rstr, get_key(p), LONG2FIX(p->line), LONG2FIX(p->cur - p->col));
 }
 
+///// batch ///////////////////////////////////////////////////////////////////
+
+// With the batch option set and a handler that responds to add_events the
+// events are collected as a flat list of event, key, and value triples and
+// passed to add_events in an Array once batch events have been collected or
+// a top level value is complete. That is one method call per batch instead
+// of one per event. Locations are not included. The events collected can be
+// limited by a batch_events method on the handler that returns the event
+// names wanted.
+
+#define BATCH_HASH_START 0x01
+#define BATCH_HASH_END 0x02
+#define BATCH_ARRAY_START 0x04
+#define BATCH_ARRAY_END 0x08
+#define BATCH_ADD_VALUE 0x10
+
+static ID add_events_id   = 0;
+static ID batch_events_id = 0;
+
+static void batch_flush(Saj d) {
+    volatile VALUE events;
+
+    if (0 == d->ecnt) {
+        return;
+    }
+    events  = rb_ary_new_from_values(d->ecnt, d->events);
+    d->ecnt = 0;
+    rb_funcall(d->handler, add_events_id, 1, events);
+}
+
+static void batch_push(ojParser p, ID event, VALUE key, VALUE value, bool end) {
+    Saj    d  = (Saj)p->ctx;
+    VALUE *ep = d->events + d->ecnt;
+
+    ep[0] = ID2SYM(event);
+    ep[1] = key;
+    ep[2] = value;
+    d->ecnt += 3;
+    if ((size_t)d->batch * 3 <= d->ecnt || (end && 0 == p->depth)) {
+        batch_flush(d);
+    }
+}
+
+static VALUE pop_key(ojParser p) {
+    Saj d = (Saj)p->ctx;
+
+    if (OBJECT_FUN != p->stack[p->depth]) {
+        return Qnil;
+    }
+    d->tail--;
+    if (d->tail < d->keys) {
+        rb_raise(rb_eIndexError, "accessing key stack");
+    }
+    return *d->tail;
+}
+
+static VALUE str_value(ojParser p) {
+    Saj         d   = (Saj)p->ctx;
+    const char *str = buf_str(&p->buf);
+    size_t      len = buf_len(&p->buf);
+
+    if (d->cache_str < len) {
+        return cache_intern(d->str_cache, str, len);
+    }
+    return rb_utf8_str_new(str, len);
+}
+
+static void batch_open_object(ojParser p) {
+    batch_push(p, oj_hash_start_id, Qnil, Qnil, false);
+}
+
+static void batch_open_object_key(ojParser p) {
+    volatile VALUE key = get_key(p);
+
+    push_key((Saj)p->ctx, key);
+    batch_push(p, oj_hash_start_id, key, Qnil, false);
+}
+
+static void batch_open_array(ojParser p) {
+    batch_push(p, oj_array_start_id, Qnil, Qnil, false);
+}
+
+static void batch_open_array_key(ojParser p) {
+    volatile VALUE key = get_key(p);
+
+    push_key((Saj)p->ctx, key);
+    batch_push(p, oj_array_start_id, key, Qnil, false);
+}
+
+// An open in an object that is not collected still pushes the key for the
+// close.
+static void batch_push_key(ojParser p) {
+    push_key((Saj)p->ctx, get_key(p));
+}
+
+static void batch_close_object(ojParser p) {
+    batch_push(p, oj_hash_end_id, pop_key(p), Qnil, true);
+}
+
+static void batch_close_array(ojParser p) {
+    batch_push(p, oj_array_end_id, pop_key(p), Qnil, true);
+}
+
+// A close that is not collected still ends a top level value.
+static void batch_close(ojParser p) {
+    pop_key(p);
+    if (0 == p->depth) {
+        batch_flush((Saj)p->ctx);
+    }
+}
+
+#define BATCH_ADD(name, value)                                           \
+    static void batch_##name(ojParser p) {                               \
+        batch_push(p, oj_add_value_id, Qnil, (value), true);             \
+    }                                                                    \
+    static void batch_##name##_key(ojParser p) {                         \
+        volatile VALUE v = (value);                                      \
+                                                                         \
+        batch_push(p, oj_add_value_id, get_key(p), v, true);             \
+    }
+
+BATCH_ADD(add_null, Qnil)
+BATCH_ADD(add_true, Qtrue)
+BATCH_ADD(add_false, Qfalse)
+BATCH_ADD(add_int, LONG2NUM(p->num.fixnum))
+BATCH_ADD(add_float, rb_float_new(p->num.dub))
+BATCH_ADD(add_big, rb_funcall(rb_cObject, oj_bigdecimal_id, 1, rb_str_new(buf_str(&p->buf), buf_len(&p->buf))))
+BATCH_ADD(add_str, str_value(p))
+
+static int batch_wanted(VALUE handler) {
+    volatile VALUE list;
+    int            wanted = 0;
+    long           i;
+
+    if (!rb_respond_to(handler, batch_events_id)) {
+        return BATCH_HASH_START | BATCH_HASH_END | BATCH_ARRAY_START | BATCH_ARRAY_END | BATCH_ADD_VALUE;
+    }
+    list = rb_funcall(handler, batch_events_id, 0);
+    rb_check_type(list, T_ARRAY);
+    for (i = 0; i < RARRAY_LEN(list); i++) {
+        ID id = rb_sym2id(rb_ary_entry(list, i));
+
+        if (oj_hash_start_id == id) {
+            wanted |= BATCH_HASH_START;
+        } else if (oj_hash_end_id == id) {
+            wanted |= BATCH_HASH_END;
+        } else if (oj_array_start_id == id) {
+            wanted |= BATCH_ARRAY_START;
+        } else if (oj_array_end_id == id) {
+            wanted |= BATCH_ARRAY_END;
+        } else if (oj_add_value_id == id) {
+            wanted |= BATCH_ADD_VALUE;
+        } else {
+            rb_raise(rb_eArgError, "%s is not a SAJ event", rb_id2name(id));
+        }
+    }
+    return wanted;
+}
+
+// Values that are not wanted are left as noop.
+static void batch_set_funcs(ojParser p, int wanted) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        Funcs f = p->funcs + i;
+
+        f->close_object = (0 != (wanted & BATCH_HASH_END)) ? batch_close_object : batch_close;
+        f->close_array  = (0 != (wanted & BATCH_ARRAY_END)) ? batch_close_array : batch_close;
+        if (OBJECT_FUN == i) {
+            f->open_object = (0 != (wanted & BATCH_HASH_START)) ? batch_open_object_key : batch_push_key;
+            f->open_array  = (0 != (wanted & BATCH_ARRAY_START)) ? batch_open_array_key : batch_push_key;
+        } else {
+            f->open_object = (0 != (wanted & BATCH_HASH_START)) ? batch_open_object : noop;
+            f->open_array  = (0 != (wanted & BATCH_ARRAY_START)) ? batch_open_array : noop;
+        }
+        if (0 == (wanted & BATCH_ADD_VALUE)) {
+            continue;
+        }
+        if (OBJECT_FUN == i) {
+            f->add_null  = batch_add_null_key;
+            f->add_true  = batch_add_true_key;
+            f->add_false = batch_add_false_key;
+            f->add_int   = batch_add_int_key;
+            f->add_float = batch_add_float_key;
+            f->add_big   = batch_add_big_key;
+            f->add_str   = batch_add_str_key;
+        } else {
+            f->add_null  = batch_add_null;
+            f->add_true  = batch_add_true;
+            f->add_false = batch_add_false;
+            f->add_int   = batch_add_int;
+            f->add_float = batch_add_float;
+            f->add_big   = batch_add_big;
+            f->add_str   = batch_add_str;
+        }
+    }
+}
+
+///// only ////////////////////////////////////////////////////////////////////
+
+// With the only option events are made only for the values on one of a list
+// of paths, as described in only.h, and for everything in an array or object
+// at the end of a path. Arrays and objects off every path are skipped by the
+// parser and no Ruby values or keys are made for anything not passed to the
+// handler. The arrays and objects that lead to a path are not reported.
+
+#define ONLY_ADD(name)                                                    \
+    static void only_##name(ojParser p) {                                 \
+        Only o = ((Saj)p->ctx)->only;                                     \
+                                                                          \
+        if (oj_only_keep(p, o, false) && (0 < p->depth || o->root_all)) { \
+            o->funcs[p->stack[p->depth]].name(p);                         \
+        }                                                                 \
+    }
+
+ONLY_ADD(add_null)
+ONLY_ADD(add_true)
+ONLY_ADD(add_false)
+ONLY_ADD(add_int)
+ONLY_ADD(add_float)
+ONLY_ADD(add_big)
+ONLY_ADD(add_str)
+
+static void only_open_array(ojParser p) {
+    Only o = ((Saj)p->ctx)->only;
+
+    if (!oj_only_keep(p, o, true)) {
+        p->skip = 1;
+    } else if (o->frames[p->depth + 1].all) {
+        o->funcs[p->stack[p->depth]].open_array(p);
+    }
+}
+
+static void only_open_object(ojParser p) {
+    Only o = ((Saj)p->ctx)->only;
+
+    if (!oj_only_keep(p, o, true)) {
+        p->skip = 1;
+    } else if (o->frames[p->depth + 1].all) {
+        o->funcs[p->stack[p->depth]].open_object(p);
+    }
+}
+
+// The frame of the array or object being closed is still the one just past
+// the parser depth.
+static void only_close_array(ojParser p) {
+    Only o = ((Saj)p->ctx)->only;
+
+    if (o->frames[p->depth + 1].all) {
+        o->funcs[p->stack[p->depth]].close_array(p);
+    } else if (0 == p->depth) {
+        batch_flush((Saj)p->ctx);
+    }
+}
+
+static void only_close_object(ojParser p) {
+    Only o = ((Saj)p->ctx)->only;
+
+    if (o->frames[p->depth + 1].all) {
+        o->funcs[p->stack[p->depth]].close_object(p);
+    } else if (0 == p->depth) {
+        batch_flush((Saj)p->ctx);
+    }
+}
+
+// Called after the handler functions are set so nothing is saved twice.
+static void only_wrap(ojParser p, Only o) {
+    int i;
+
+    memcpy(o->funcs, p->funcs, sizeof(o->funcs));
+    for (i = 0; i < 3; i++) {
+        Funcs f = p->funcs + i;
+
+        f->add_null     = only_add_null;
+        f->add_true     = only_add_true;
+        f->add_false    = only_add_false;
+        f->add_int      = only_add_int;
+        f->add_float    = only_add_float;
+        f->add_big      = only_add_big;
+        f->add_str      = only_add_str;
+        f->open_array   = only_open_array;
+        f->close_array  = only_close_array;
+        f->open_object  = only_open_object;
+        f->close_object = only_close_object;
+    }
+}
+
 static void reset(ojParser p) {
     Funcs end = p->funcs + 3;
     Funcs f;
@@ -373,6 +661,114 @@ static void reset(ojParser p) {
     }
 }
 
+// Sets the functions for the handler methods that are defined, with or
+// without locations depending on the method arity.
+static void handler_set_funcs(ojParser p, VALUE value) {
+    if (rb_respond_to(value, oj_hash_start_id)) {
+        if (1 == rb_obj_method_arity(value, oj_hash_start_id)) {
+            p->funcs[TOP_FUN].open_object    = open_object;
+            p->funcs[ARRAY_FUN].open_object  = open_object;
+            p->funcs[OBJECT_FUN].open_object = open_object_key;
+        } else {
+            p->funcs[TOP_FUN].open_object    = open_object_loc;
+            p->funcs[ARRAY_FUN].open_object  = open_object_loc;
+            p->funcs[OBJECT_FUN].open_object = open_object_loc_key;
+        }
+    }
+    if (rb_respond_to(value, oj_array_start_id)) {
+        if (1 == rb_obj_method_arity(value, oj_array_start_id)) {
+            p->funcs[TOP_FUN].open_array    = open_array;
+            p->funcs[ARRAY_FUN].open_array  = open_array;
+            p->funcs[OBJECT_FUN].open_array = open_array_key;
+        } else {
+            p->funcs[TOP_FUN].open_array    = open_array_loc;
+            p->funcs[ARRAY_FUN].open_array  = open_array_loc;
+            p->funcs[OBJECT_FUN].open_array = open_array_loc_key;
+        }
+    }
+    if (rb_respond_to(value, oj_hash_end_id)) {
+        if (1 == rb_obj_method_arity(value, oj_hash_end_id)) {
+            p->funcs[TOP_FUN].close_object    = close_object;
+            p->funcs[ARRAY_FUN].close_object  = close_object;
+            p->funcs[OBJECT_FUN].close_object = close_object;
+        } else {
+            p->funcs[TOP_FUN].close_object    = close_object_loc;
+            p->funcs[ARRAY_FUN].close_object  = close_object_loc;
+            p->funcs[OBJECT_FUN].close_object = close_object_loc;
+        }
+    }
+    if (rb_respond_to(value, oj_array_end_id)) {
+        if (1 == rb_obj_method_arity(value, oj_array_end_id)) {
+            p->funcs[TOP_FUN].close_array    = close_array;
+            p->funcs[ARRAY_FUN].close_array  = close_array;
+            p->funcs[OBJECT_FUN].close_array = close_array;
+        } else {
+            p->funcs[TOP_FUN].close_array    = close_array_loc;
+            p->funcs[ARRAY_FUN].close_array  = close_array_loc;
+            p->funcs[OBJECT_FUN].close_array = close_array_loc;
+        }
+    }
+    if (rb_respond_to(value, oj_add_value_id)) {
+        if (2 == rb_obj_method_arity(value, oj_add_value_id)) {
+            p->funcs[TOP_FUN].add_null    = add_null;
+            p->funcs[ARRAY_FUN].add_null  = add_null;
+            p->funcs[OBJECT_FUN].add_null = add_null_key;
+
+            p->funcs[TOP_FUN].add_true    = add_true;
+            p->funcs[ARRAY_FUN].add_true  = add_true;
+            p->funcs[OBJECT_FUN].add_true = add_true_key;
+
+            p->funcs[TOP_FUN].add_false    = add_false;
+            p->funcs[ARRAY_FUN].add_false  = add_false;
+            p->funcs[OBJECT_FUN].add_false = add_false_key;
+
+            p->funcs[TOP_FUN].add_int    = add_int;
+            p->funcs[ARRAY_FUN].add_int  = add_int;
+            p->funcs[OBJECT_FUN].add_int = add_int_key;
+
+            p->funcs[TOP_FUN].add_float    = add_float;
+            p->funcs[ARRAY_FUN].add_float  = add_float;
+            p->funcs[OBJECT_FUN].add_float = add_float_key;
+
+            p->funcs[TOP_FUN].add_big    = add_big;
+            p->funcs[ARRAY_FUN].add_big  = add_big;
+            p->funcs[OBJECT_FUN].add_big = add_big_key;
+
+            p->funcs[TOP_FUN].add_str    = add_str;
+            p->funcs[ARRAY_FUN].add_str  = add_str;
+            p->funcs[OBJECT_FUN].add_str = add_str_key;
+        } else {
+            p->funcs[TOP_FUN].add_null    = add_null_loc;
+            p->funcs[ARRAY_FUN].add_null  = add_null_loc;
+            p->funcs[OBJECT_FUN].add_null = add_null_key_loc;
+
+            p->funcs[TOP_FUN].add_true    = add_true_loc;
+            p->funcs[ARRAY_FUN].add_true  = add_true_loc;
+            p->funcs[OBJECT_FUN].add_true = add_true_key_loc;
+
+            p->funcs[TOP_FUN].add_false    = add_false_loc;
+            p->funcs[ARRAY_FUN].add_false  = add_false_loc;
+            p->funcs[OBJECT_FUN].add_false = add_false_key_loc;
+
+            p->funcs[TOP_FUN].add_int    = add_int_loc;
+            p->funcs[ARRAY_FUN].add_int  = add_int_loc;
+            p->funcs[OBJECT_FUN].add_int = add_int_key_loc;
+
+            p->funcs[TOP_FUN].add_float    = add_float_loc;
+            p->funcs[ARRAY_FUN].add_float  = add_float_loc;
+            p->funcs[OBJECT_FUN].add_float = add_float_key_loc;
+
+            p->funcs[TOP_FUN].add_big    = add_big_loc;
+            p->funcs[ARRAY_FUN].add_big  = add_big_loc;
+            p->funcs[OBJECT_FUN].add_big = add_big_key_loc;
+
+            p->funcs[TOP_FUN].add_str    = add_str_loc;
+            p->funcs[ARRAY_FUN].add_str  = add_str_loc;
+            p->funcs[OBJECT_FUN].add_str = add_str_key_loc;
+        }
+    }
+}
+
 static VALUE option(ojParser p, const char *key, VALUE value) {
     Saj d = (Saj)p->ctx;
 
@@ -381,112 +777,58 @@ static VALUE option(ojParser p, const char *key, VALUE value) {
     }
     if (0 == strcmp(key, "handler=")) {
         d->tail    = d->keys;
+        d->ecnt    = 0;
         d->handler = value;
         reset(p);
-        if (rb_respond_to(value, oj_hash_start_id)) {
-            if (1 == rb_obj_method_arity(value, oj_hash_start_id)) {
-                p->funcs[TOP_FUN].open_object    = open_object;
-                p->funcs[ARRAY_FUN].open_object  = open_object;
-                p->funcs[OBJECT_FUN].open_object = open_object_key;
-            } else {
-                p->funcs[TOP_FUN].open_object    = open_object_loc;
-                p->funcs[ARRAY_FUN].open_object  = open_object_loc;
-                p->funcs[OBJECT_FUN].open_object = open_object_loc_key;
-            }
+        if (0 < d->batch && rb_respond_to(value, add_events_id)) {
+            batch_set_funcs(p, batch_wanted(value));
+        } else {
+            handler_set_funcs(p, value);
+        }
+        if (NULL != d->only) {
+            only_wrap(p, d->only);
+        }
+        return Qnil;
+    }
+    if (0 == strcmp(key, "batch")) {
+        return INT2NUM(d->batch);
+    }
+    if (0 == strcmp(key, "batch=")) {
+        int batch = (Qnil == value) ? 0 : NUM2INT(value);
+
+        if (batch < 0) {
+            batch = 0;
         }
-        if (rb_respond_to(value, oj_array_start_id)) {
-            if (1 == rb_obj_method_arity(value, oj_array_start_id)) {
-                p->funcs[TOP_FUN].open_array    = open_array;
-                p->funcs[ARRAY_FUN].open_array  = open_array;
-                p->funcs[OBJECT_FUN].open_array = open_array_key;
-            } else {
-                p->funcs[TOP_FUN].open_array    = open_array_loc;
-                p->funcs[ARRAY_FUN].open_array  = open_array_loc;
-                p->funcs[OBJECT_FUN].open_array = open_array_loc_key;
-            }
+        d->ecnt = 0;
+        if (d->batch < batch) {
+            OJ_R_REALLOC_N(d->events, VALUE, (size_t)batch * 3);
         }
-        if (rb_respond_to(value, oj_hash_end_id)) {
-            if (1 == rb_obj_method_arity(value, oj_hash_end_id)) {
-                p->funcs[TOP_FUN].close_object    = close_object;
-                p->funcs[ARRAY_FUN].close_object  = close_object;
-                p->funcs[OBJECT_FUN].close_object = close_object;
-            } else {
-                p->funcs[TOP_FUN].close_object    = close_object_loc;
-                p->funcs[ARRAY_FUN].close_object  = close_object_loc;
-                p->funcs[OBJECT_FUN].close_object = close_object_loc;
-            }
+        d->batch = batch;
+        option(p, "handler=", d->handler);
+
+        return INT2NUM(d->batch);
+    }
+    if (0 == strcmp(key, "only")) {
+        return (NULL == d->only) ? Qnil : d->only->list;
+    }
+    if (0 == strcmp(key, "only=")) {
+        volatile VALUE list = Qnil;
+
+        // The list is checked before the current one is dropped so a bad
+        // value leaves the parser as it was.
+        if (Qnil != value) {
+            list = oj_only_list(p, value, "only");
         }
-        if (rb_respond_to(value, oj_array_end_id)) {
-            if (1 == rb_obj_method_arity(value, oj_array_end_id)) {
-                p->funcs[TOP_FUN].close_array    = close_array;
-                p->funcs[ARRAY_FUN].close_array  = close_array;
-                p->funcs[OBJECT_FUN].close_array = close_array;
-            } else {
-                p->funcs[TOP_FUN].close_array    = close_array_loc;
-                p->funcs[ARRAY_FUN].close_array  = close_array_loc;
-                p->funcs[OBJECT_FUN].close_array = close_array_loc;
-            }
+        if (NULL != d->only) {
+            oj_only_free(d->only);
+            d->only = NULL;
         }
-        if (rb_respond_to(value, oj_add_value_id)) {
-            if (2 == rb_obj_method_arity(value, oj_add_value_id)) {
-                p->funcs[TOP_FUN].add_null    = add_null;
-                p->funcs[ARRAY_FUN].add_null  = add_null;
-                p->funcs[OBJECT_FUN].add_null = add_null_key;
-
-                p->funcs[TOP_FUN].add_true    = add_true;
-                p->funcs[ARRAY_FUN].add_true  = add_true;
-                p->funcs[OBJECT_FUN].add_true = add_true_key;
-
-                p->funcs[TOP_FUN].add_false    = add_false;
-                p->funcs[ARRAY_FUN].add_false  = add_false;
-                p->funcs[OBJECT_FUN].add_false = add_false_key;
-
-                p->funcs[TOP_FUN].add_int    = add_int;
-                p->funcs[ARRAY_FUN].add_int  = add_int;
-                p->funcs[OBJECT_FUN].add_int = add_int_key;
-
-                p->funcs[TOP_FUN].add_float    = add_float;
-                p->funcs[ARRAY_FUN].add_float  = add_float;
-                p->funcs[OBJECT_FUN].add_float = add_float_key;
-
-                p->funcs[TOP_FUN].add_big    = add_big;
-                p->funcs[ARRAY_FUN].add_big  = add_big;
-                p->funcs[OBJECT_FUN].add_big = add_big_key;
-
-                p->funcs[TOP_FUN].add_str    = add_str;
-                p->funcs[ARRAY_FUN].add_str  = add_str;
-                p->funcs[OBJECT_FUN].add_str = add_str_key;
-            } else {
-                p->funcs[TOP_FUN].add_null    = add_null_loc;
-                p->funcs[ARRAY_FUN].add_null  = add_null_loc;
-                p->funcs[OBJECT_FUN].add_null = add_null_key_loc;
-
-                p->funcs[TOP_FUN].add_true    = add_true_loc;
-                p->funcs[ARRAY_FUN].add_true  = add_true_loc;
-                p->funcs[OBJECT_FUN].add_true = add_true_key_loc;
-
-                p->funcs[TOP_FUN].add_false    = add_false_loc;
-                p->funcs[ARRAY_FUN].add_false  = add_false_loc;
-                p->funcs[OBJECT_FUN].add_false = add_false_key_loc;
-
-                p->funcs[TOP_FUN].add_int    = add_int_loc;
-                p->funcs[ARRAY_FUN].add_int  = add_int_loc;
-                p->funcs[OBJECT_FUN].add_int = add_int_key_loc;
-
-                p->funcs[TOP_FUN].add_float    = add_float_loc;
-                p->funcs[ARRAY_FUN].add_float  = add_float_loc;
-                p->funcs[OBJECT_FUN].add_float = add_float_key_loc;
-
-                p->funcs[TOP_FUN].add_big    = add_big_loc;
-                p->funcs[ARRAY_FUN].add_big  = add_big_loc;
-                p->funcs[OBJECT_FUN].add_big = add_big_key_loc;
-
-                p->funcs[TOP_FUN].add_str    = add_str_loc;
-                p->funcs[ARRAY_FUN].add_str  = add_str_loc;
-                p->funcs[OBJECT_FUN].add_str = add_str_key_loc;
-            }
+        if (Qnil != list) {
+            d->only = oj_only_create(list);
         }
-        return Qnil;
+        option(p, "handler=", d->handler);
+
+        return list;
     }
     if (0 == strcmp(key, "cache_keys")) {
         return d->cache_keys ? Qtrue : Qfalse;
@@ -524,6 +866,7 @@ static void start(ojParser p) {
     Saj d = (Saj)p->ctx;
 
     d->tail = d->keys;
+    d->ecnt = 0;
 }
 
 static void dfree(ojParser p) {
@@ -532,6 +875,12 @@ static void dfree(ojParser p) {
     if (NULL != d->keys) {
         OJ_R_FREE(d->keys);
     }
+    if (NULL != d->events) {
+        OJ_R_FREE(d->events);
+    }
+    if (NULL != d->only) {
+        oj_only_free(d->only);
+    }
     cache_free(d->str_cache);
     OJ_R_FREE(p->ctx);
 }
@@ -547,11 +896,17 @@ static void mark(ojParser p) {
     if (Qnil != d->handler) {
         rb_gc_mark(d->handler);
     }
+    if (NULL != d->only) {
+        rb_gc_mark(d->only->list);
+    }
     if (!d->cache_keys) {
         for (kp = d->keys; kp < d->tail; kp++) {
             rb_gc_mark(*kp);
         }
     }
+    for (kp = d->events; kp < d->events + d->ecnt; kp++) {
+        rb_gc_mark(*kp);
+    }
 }
 
 static VALUE form_str(const char *str, size_t len) {
@@ -567,6 +922,10 @@ void oj_init_saj(ojParser p, Saj d) {
     d->cache_str   = 16;
     d->cache_keys  = true;
     d->thread_safe = false;
+    d->events      = NULL;
+    d->ecnt        = 0;
+    d->batch       = 0;
+    d->only        = NULL;
 
     p->ctx = (void *)d;
     reset(p);
@@ -575,6 +934,11 @@ void oj_init_saj(ojParser p, Saj d) {
     p->free   = dfree;
     p->mark   = mark;
     p->start  = start;
+
+    if (0 == add_events_id) {
+        add_events_id   = rb_intern("add_events");
+        batch_events_id = rb_intern("batch_events");
+    }
 }
 
 void oj_set_parser_saj(ojParser p) {
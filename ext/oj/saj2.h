@@ -4,6 +4,7 @@
 #include <stdbool.h>
 
 struct _cache;
+struct _only;
 struct _ojParser;
 
 typedef struct _saj {
@@ -11,6 +12,10 @@ typedef struct _saj {
     VALUE         *keys;
     VALUE         *tail;
     size_t         klen;
+    VALUE         *events;  // event, key, and value triples when batching
+    size_t         ecnt;
+    int            batch;   // events per add_events call, 0 if not batching
+    struct _only  *only;    // NULL unless the only option is set
     struct _cache *str_cache;
     uint8_t        cache_str;
     bool           cache_keys;
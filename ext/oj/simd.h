@@ -5,8 +5,17 @@
 // This header provides unified SIMD support across different CPU architectures
 // with cross-platform runtime detection (Windows/Linux/Mac)
 
-// SIMD implementation enum - used for runtime selection
-typedef enum _simd_implementation { SIMD_NONE, SIMD_NEON, SIMD_SSE2, SIMD_SSE42 } SIMD_Implementation;
+// SIMD implementation enum - used for runtime selection. The x86 tiers are in
+// ascending order so SIMD_SSE42 <= SIMD_Impl is true for any CPU that has at
+// least SSE4.2.
+typedef enum _simd_implementation {
+    SIMD_NONE,
+    SIMD_NEON,
+    SIMD_SSE2,
+    SIMD_SSE42,
+    SIMD_AVX2,
+    SIMD_AVX512,  // AVX-512F and AVX-512BW
+} SIMD_Implementation;
 
 // Define in oj.c.
 extern SIMD_Implementation SIMD_Impl;
@@ -83,6 +92,31 @@ static inline int oj_ctz64_fallback(uint64_t x) {
 #define OJ_CTZ64(x) oj_ctz64_fallback(x)
 #endif
 
+// Population count and count leading zeros (for bitmap scanning)
+#if defined(__GNUC__) || defined(__clang__)
+#define OJ_POPCOUNT64(x) __builtin_popcountll(x)
+#define OJ_CLZ64(x) __builtin_clzll(x)
+#else
+static inline int oj_popcount64_fallback(uint64_t x) {
+    int count = 0;
+    for (; 0 != x; x &= x - 1) {
+        count++;
+    }
+    return count;
+}
+
+static inline int oj_clz64_fallback(uint64_t x) {
+    int count = 0;
+    while (0 == (x & 0x8000000000000000ULL) && count < 64) {
+        x <<= 1;
+        count++;
+    }
+    return count;
+}
+#define OJ_POPCOUNT64(x) oj_popcount64_fallback(x)
+#define OJ_CLZ64(x) oj_clz64_fallback(x)
+#endif
+
 // =============================================================================
 // x86/x86_64 SIMD detection
 // =============================================================================
@@ -95,6 +129,8 @@ static inline int oj_ctz64_fallback(uint64_t x) {
 #include <intrin.h>
 #define HAVE_SIMD_SSE4_2 1
 #define HAVE_SIMD_SSE2 1
+#define HAVE_SIMD_AVX2 1
+#define HAVE_SIMD_AVX512 1
 #elif defined(__GNUC__) || defined(__clang__)
 // GCC/Clang: check for header availability and include them
 // We include headers but use target attributes to enable instructions per-function
@@ -107,12 +143,16 @@ static inline int oj_ctz64_fallback(uint64_t x) {
 #include <x86intrin.h>
 #define HAVE_SIMD_SSE4_2 1
 #define HAVE_SIMD_SSE2 1
+#define HAVE_SIMD_AVX2 1
+#define HAVE_SIMD_AVX512 1
 #else
 // Try to include headers anyway for target attribute functions
 #if __has_include(<x86intrin.h>)
 #include <x86intrin.h>
 #define HAVE_SIMD_SSE4_2 1
 #define HAVE_SIMD_SSE2 1
+#define HAVE_SIMD_AVX2 1
+#define HAVE_SIMD_AVX512 1
 #elif __has_include(<nmmintrin.h>)
 #include <nmmintrin.h>
 #define HAVE_SIMD_SSE4_2 1
@@ -128,10 +168,14 @@ static inline int oj_ctz64_fallback(uint64_t x) {
 #if defined(__clang__) || defined(__GNUC__)
 #define OJ_TARGET_SSE42 __attribute__((target("sse4.2")))
 #define OJ_TARGET_SSE2 __attribute__((target("sse2")))
+#define OJ_TARGET_AVX2 __attribute__((target("avx2")))
+#define OJ_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
 #else
 // MSVC doesn't need target attributes - intrinsics are always available
 #define OJ_TARGET_SSE42
 #define OJ_TARGET_SSE2
+#define OJ_TARGET_AVX2
+#define OJ_TARGET_AVX512
 #endif
 
 #endif  // x86/x86_64
@@ -216,4 +260,17 @@ inline static void fast_memcpy16(void *dest, const void *src, size_t n) {
 }
 #endif
 
+// =============================================================================
+// White space skipping shared by the parsers
+// =============================================================================
+
+// Returns the first byte at or after b that is not a space, tab, carriage
+// return, or newline, or end if they run to end. Form feeds are left to the
+// callers that accept them. When line is not NULL each newline passed over is
+// added to it and *nl is set to the last one so the caller can keep its line
+// and column bookkeeping. Callers check for white space at b first since
+// compact JSON has none. Implemented in parse.c with the kernel picked by
+// oj_scanner_init().
+extern const char *oj_skip_white(const char *b, const char *end, long *line, const char **nl);
+
 #endif /* OJ_SIMD_H */
@@ -200,6 +200,31 @@ static void unicode_to_chars(ParseInfo pi, Buf buf, uint32_t code) {
     }
 }
 
+// Moves the reader past the bytes already in the buffer that can not end a
+// string, keeping the line and column in step with what reader_get() would
+// have counted.
+static inline void skip_str_chars(Reader rd) {
+    const char *s = oj_scan_string(rd->tail, rd->read_end);
+    const char *nl;
+
+    if (s == rd->tail) {
+        return;
+    }
+    rd->pos += s - rd->tail;
+    if (NULL == (nl = memchr(rd->tail, '\n', s - rd->tail))) {
+        rd->col += (int)(s - rd->tail);
+    } else {
+        const char *last;
+
+        for (last = nl; NULL != (nl = memchr(nl + 1, '\n', s - nl - 1)); last = nl) {
+            rd->line++;
+        }
+        rd->line++;
+        rd->col = (int)(s - last);
+    }
+    rd->tail = (char *)s;
+}
+
 // entered at backslash
 static void read_escaped_str(ParseInfo pi) {
     struct _buf buf;
@@ -211,7 +236,14 @@ static void read_escaped_str(ParseInfo pi) {
     if (pi->rd.str < pi->rd.tail) {
         buf_append_string(&buf, pi->rd.str, pi->rd.tail - pi->rd.str);
     }
-    while ('\"' != (c = reader_get(&pi->rd))) {
+    for (;;) {
+        const char *plain = pi->rd.tail;
+
+        skip_str_chars(&pi->rd);
+        buf_append_string(&buf, plain, pi->rd.tail - plain);
+        if ('\"' == (c = reader_get(&pi->rd))) {
+            break;
+        }
         if ('\0' == c) {
             oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "quoted string not terminated");
             buf_cleanup(&buf);
@@ -332,7 +364,11 @@ static void read_str(ParseInfo pi) {
     char c;
 
     reader_protect(&pi->rd);
-    while ('\"' != (c = reader_get(&pi->rd))) {
+    for (;;) {
+        skip_str_chars(&pi->rd);
+        if ('\"' == (c = reader_get(&pi->rd))) {
+            break;
+        }
         if ('\0' == c) {
             oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "quoted string not terminated");
             return;
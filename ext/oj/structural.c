@@ -0,0 +1,159 @@
+// Copyright (c) 2026, Peter Ohler, All rights reserved.
+// Licensed under the MIT License. See LICENSE file in the project root for license details.
+
+#include "structural.h"
+
+#include <string.h>
+
+// Each classifier fills in the two bitmaps for one 64 byte block. Bit i of
+// each word is byte i of the block.
+typedef void (*ClassifyFunc)(const uint8_t *src, uint64_t *white, uint64_t *newline);
+
+static void classify_block(const uint8_t *src, uint64_t *white, uint64_t *newline) {
+    uint64_t w = 0;
+    uint64_t n = 0;
+    int      i;
+
+    for (i = 0; i < OJ_INDEX_BLOCK; i++) {
+        uint64_t bit = ((uint64_t)1) << i;
+
+        switch (src[i]) {
+        case '\n': n |= bit;  // fall through
+        case '\t':
+        case '\r':
+        case ' ': w |= bit; break;
+        default: break;
+        }
+    }
+    *white   = w;
+    *newline = n;
+}
+
+#ifdef HAVE_SIMD_SSE2
+static OJ_TARGET_SSE2 void classify_block_sse2(const uint8_t *src, uint64_t *white, uint64_t *newline) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab   = _mm_set1_epi8('\t');
+    const __m128i cr    = _mm_set1_epi8('\r');
+    const __m128i nl    = _mm_set1_epi8('\n');
+    uint64_t      w     = 0;
+    uint64_t      n     = 0;
+    int           i;
+
+    for (i = 0; i < OJ_INDEX_BLOCK; i += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(src + i));
+        const __m128i is_nl = _mm_cmpeq_epi8(chunk, nl);
+        const __m128i is_white =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                         _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), is_nl));
+
+        w |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_white) << i;
+        n |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_nl) << i;
+    }
+    *white   = w;
+    *newline = n;
+}
+#endif
+
+#ifdef HAVE_SIMD_AVX2
+static OJ_TARGET_AVX2 void classify_block_avx2(const uint8_t *src, uint64_t *white, uint64_t *newline) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab   = _mm256_set1_epi8('\t');
+    const __m256i cr    = _mm256_set1_epi8('\r');
+    const __m256i nl    = _mm256_set1_epi8('\n');
+    uint64_t      w     = 0;
+    uint64_t      n     = 0;
+    int           i;
+
+    for (i = 0; i < OJ_INDEX_BLOCK; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i *)(src + i));
+        const __m256i is_nl = _mm256_cmpeq_epi8(chunk, nl);
+        const __m256i is_white =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr), is_nl));
+
+        w |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_white) << i;
+        n |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_nl) << i;
+    }
+    *white   = w;
+    *newline = n;
+}
+#endif
+
+#ifdef HAVE_SIMD_NEON
+// NEON has no movemask so each lane is masked with its bit position and the
+// lanes are summed pairwise down to 16 bits per 16 byte vector.
+static inline uint64_t neon_mask64(uint8x16_t v0, uint8x16_t v1, uint8x16_t v2, uint8x16_t v3) {
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t     bit_mask = vld1q_u8(bits);
+    uint8x16_t           sum0     = vpaddq_u8(vandq_u8(v0, bit_mask), vandq_u8(v1, bit_mask));
+    uint8x16_t           sum1     = vpaddq_u8(vandq_u8(v2, bit_mask), vandq_u8(v3, bit_mask));
+
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+static void classify_block_neon(const uint8_t *src, uint64_t *white, uint64_t *newline) {
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t tab   = vdupq_n_u8('\t');
+    const uint8x16_t cr    = vdupq_n_u8('\r');
+    const uint8x16_t nl    = vdupq_n_u8('\n');
+    uint8x16_t       w[4];
+    uint8x16_t       n[4];
+    int              i;
+
+    for (i = 0; i < 4; i++) {
+        const uint8x16_t chunk = vld1q_u8(src + i * 16);
+
+        n[i] = vceqq_u8(chunk, nl);
+        w[i] = vorrq_u8(vorrq_u8(vceqq_u8(chunk, space), vceqq_u8(chunk, tab)), vorrq_u8(vceqq_u8(chunk, cr), n[i]));
+    }
+    *white   = neon_mask64(w[0], w[1], w[2], w[3]);
+    *newline = neon_mask64(n[0], n[1], n[2], n[3]);
+}
+#endif
+
+static ClassifyFunc classify = classify_block;
+
+void oj_index_init(void) {
+    switch (SIMD_Impl) {
+#ifdef HAVE_SIMD_AVX2
+    case SIMD_AVX512:
+    case SIMD_AVX2: classify = classify_block_avx2; break;
+#endif
+#ifdef HAVE_SIMD_SSE2
+    case SIMD_SSE42:
+    case SIMD_SSE2: classify = classify_block_sse2; break;
+#endif
+#ifdef HAVE_SIMD_NEON
+    case SIMD_NEON: classify = classify_block_neon; break;
+#endif
+    default: classify = classify_block; break;
+    }
+}
+
+void oj_index_fill(ojIndex x, const uint8_t *from) {
+    const uint8_t *b = from;
+    int            i;
+
+    x->base = from;
+    for (i = 0; i < OJ_INDEX_BLOCKS && b < x->end; i++, b += OJ_INDEX_BLOCK) {
+        if (OJ_INDEX_BLOCK <= x->end - b) {
+            classify(b, x->white + i, x->newline + i);
+        } else {
+            // The last partial block is copied so nothing past the end of the
+            // input is read. The zero padding is not white, the same as the
+            // NUL terminator.
+            uint8_t tail[OJ_INDEX_BLOCK];
+
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, b, x->end - b);
+            classify(tail, x->white + i, x->newline + i);
+        }
+    }
+    x->limit = b;
+    if (x->end < x->limit) {
+        x->limit = x->end;
+    }
+}
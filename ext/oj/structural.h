@@ -0,0 +1,99 @@
+// Copyright (c) 2026, Peter Ohler, All rights reserved.
+// Licensed under the MIT License. See LICENSE file in the project root for license details.
+
+#ifndef OJ_STRUCTURAL_H
+#define OJ_STRUCTURAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "simd.h"
+
+// The structural index is the first stage of a two stage parse. Stage one
+// classifies every byte of a window of the input with SIMD instructions and
+// records the classes as bitmaps, one bit per byte. Stage two is the parser
+// state machine in parser.c which then jumps over long runs of white space
+// with a bit scan instead of dispatching on every byte through the state maps.
+//
+// Two bitmaps are kept:
+//
+//   white    space, tab, carriage return, and newline
+//   newline  just the newline, so skipped lines can still be counted
+//
+// String content is not indexed. The string scanners check the first eight
+// bytes in place and then stop at the first special byte without classifying
+// the rest of the window so they are faster than the index at every length.
+//
+// The index covers a window of the input and is refilled as the parser moves
+// past the end of it so memory use does not depend on the document size.
+// Filling a window costs more than a short skip saves so the parser only
+// starts the index once it finds a long run of white space and stops again
+// when the skips stay short.
+
+// Inputs shorter than this are scanned directly.
+#define OJ_INDEX_MIN_LEN 1024
+// A white space run at least this long starts the index.
+#define OJ_INDEX_RUN_MIN 256
+// This many skips in a row that end in their first block stop it.
+#define OJ_INDEX_SHORT_MAX 32
+
+#define OJ_INDEX_BLOCK 64
+#define OJ_INDEX_BLOCKS 64
+
+typedef struct _ojIndex {
+    const uint8_t *base;    // first byte covered by the window
+    const uint8_t *limit;   // one past the last byte covered by the window
+    const uint8_t *end;     // end of the input
+    int            shorts;  // short skips in a row
+    uint64_t       white[OJ_INDEX_BLOCKS];
+    uint64_t       newline[OJ_INDEX_BLOCKS];
+} *ojIndex;
+
+// Selects the block classifier for the detected SIMD implementation.
+extern void oj_index_init(void);
+
+// Fills the window starting at from.
+extern void oj_index_fill(ojIndex x, const uint8_t *from);
+
+static inline void oj_index_start(ojIndex x, const uint8_t *json, const uint8_t *end) {
+    x->base   = json;
+    x->limit  = json;
+    x->end    = end;
+    x->shorts = 0;
+}
+
+// Returns the first byte at or after b that is not white space. Newlines
+// skipped along the way are added to line and col is left at the offset from
+// json of the last one, the same bookkeeping the state machine does for each
+// newline it steps over.
+static inline const uint8_t *oj_index_skip_white(ojIndex x, const uint8_t *b, const uint8_t *json, long *line, long *col) {
+    while (b < x->end) {
+        if (b < x->base || x->limit <= b) {
+            oj_index_fill(x, b);
+        }
+        size_t   off   = b - x->base;
+        size_t   wi    = off / OJ_INDEX_BLOCK;
+        int      shift = (int)(off % OJ_INDEX_BLOCK);
+        uint64_t m     = ~x->white[wi] >> shift;
+        uint64_t nl    = x->newline[wi] >> shift;
+        int      n     = OJ_INDEX_BLOCK - shift;
+
+        if (0 != m) {
+            n = OJ_CTZ64(m);
+            // Only the newlines before the stop count.
+            nl &= (((uint64_t)1) << n) - 1;
+        }
+        if (0 != nl) {
+            *line += OJ_POPCOUNT64(nl);
+            *col = (long)(b - json) + 63 - OJ_CLZ64(nl);
+        }
+        if (0 != m) {
+            return b + n;
+        }
+        b += n;
+    }
+    return x->end;
+}
+
+#endif /* OJ_STRUCTURAL_H */
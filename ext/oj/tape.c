@@ -0,0 +1,659 @@
+// Copyright (c) 2026, Peter Ohler, All rights reserved.
+// Licensed under the MIT License. See LICENSE file in the project root for license details.
+
+#include "mem.h"
+#include "oj.h"
+#include "parser.h"
+
+// The tape delegate records a document as a flat array of 64 bit words and
+// creates no Ruby objects while parsing. Ruby objects are made only for the
+// members that are asked for through an Oj::Tape so reading a few fields out
+// of a document does not pay for building the whole thing.
+//
+// Each entry starts with a word that has the tag in the top byte and a
+// payload in the rest:
+//
+//   null, true, false  one word, no payload
+//   integer, float     the second word is the int64_t or double bits
+//   string, big, key   the payload is the offset into the string arena and the
+//                      second word is the length
+//   array, object      the payload is the index of the word after the last
+//                      member and the second word is the member count
+//
+// Object members are a key entry followed by the value entry. Since the parser
+// has already removed escapes the strings are kept in an arena owned by the
+// tape instead of pointing back into the source.
+
+#define TAPE_TAG(w) ((char)((w) >> 56))
+#define TAPE_PAYLOAD(w) ((w) & 0x00FFFFFFFFFFFFFFULL)
+#define TAPE_WORD(tag, payload) (((uint64_t)(uint8_t)(tag) << 56) | (uint64_t)(payload))
+
+#define TAPE_KEY 'k'
+#define TAPE_ARRAY '['
+#define TAPE_OBJECT '{'
+
+// The first two words are saved for an array header used when there is more
+// than one document at the top level.
+#define TAPE_HEAD 2
+
+typedef struct _tapeData {
+    uint64_t *words;
+    size_t    wlen;
+    size_t    wcap;
+    char     *str;
+    size_t    slen;
+    size_t    scap;
+} *TapeData;
+
+typedef struct _frame {
+    size_t at;   // index of the open entry
+    size_t cnt;  // members so far
+} *Frame;
+
+typedef struct _tapeDelegate {
+    TapeData data;
+    Frame    head;
+    Frame    tail;
+    Frame    end;
+    size_t   top;  // documents at the top level
+} *TapeDelegate;
+
+typedef struct _tape {
+    VALUE    root;  // the Oj::Tape that owns the data, self for the root
+    TapeData data;
+    size_t   at;
+} *Tape;
+
+static VALUE tape_class = Qundef;
+
+static void data_free(TapeData d) {
+    if (NULL != d) {
+        OJ_R_FREE(d->words);
+        OJ_R_FREE(d->str);
+        OJ_R_FREE(d);
+    }
+}
+
+static uint64_t *push_words(TapeData d, size_t cnt) {
+    uint64_t *w;
+
+    if (d->wcap < d->wlen + cnt) {
+        d->wcap = d->wcap * 2 + cnt;
+        OJ_R_REALLOC_N(d->words, uint64_t, d->wcap);
+    }
+    w = d->words + d->wlen;
+    d->wlen += cnt;
+
+    return w;
+}
+
+static size_t push_str(TapeData d, Buf b) {
+    size_t len = buf_len(b);
+    size_t off = d->slen;
+
+    if (d->scap < d->slen + len) {
+        d->scap = d->scap * 2 + len;
+        OJ_R_REALLOC_N(d->str, char, d->scap);
+    }
+    memcpy(d->str + d->slen, buf_str(b), len);
+    d->slen += len;
+
+    return off;
+}
+
+// Counts a new member of the open array or object.
+static void member(TapeDelegate td) {
+    if (td->head < td->tail) {
+        td->tail[-1].cnt++;
+    } else {
+        td->top++;
+    }
+}
+
+static void add_scalar(ojParser p, char tag) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+
+    member(td);
+    *push_words(td->data, 1) = TAPE_WORD(tag, 0);
+}
+
+static void add_string(ojParser p, char tag, Buf b) {
+    TapeData  d   = ((TapeDelegate)p->ctx)->data;
+    size_t    off = push_str(d, b);
+    uint64_t *w   = push_words(d, 2);
+
+    w[0] = TAPE_WORD(tag, off);
+    w[1] = buf_len(b);
+}
+
+static void add_key(ojParser p) {
+    add_string(p, TAPE_KEY, &p->key);
+}
+
+static void add_null(ojParser p) {
+    add_scalar(p, OJ_NULL);
+}
+
+static void add_true(ojParser p) {
+    add_scalar(p, OJ_TRUE);
+}
+
+static void add_false(ojParser p) {
+    add_scalar(p, OJ_FALSE);
+}
+
+static void add_int(ojParser p) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+    uint64_t    *w;
+
+    member(td);
+    w    = push_words(td->data, 2);
+    w[0] = TAPE_WORD(OJ_INT, 0);
+    w[1] = (uint64_t)p->num.fixnum;
+}
+
+static void add_float(ojParser p) {
+    TapeDelegate td  = (TapeDelegate)p->ctx;
+    double       dub = (double)p->num.dub;
+    uint64_t    *w;
+
+    member(td);
+    w    = push_words(td->data, 2);
+    w[0] = TAPE_WORD(OJ_DECIMAL, 0);
+    memcpy(w + 1, &dub, sizeof(dub));
+}
+
+static void add_big(ojParser p) {
+    member((TapeDelegate)p->ctx);
+    add_string(p, OJ_BIG, &p->buf);
+}
+
+static void add_str(ojParser p) {
+    member((TapeDelegate)p->ctx);
+    add_string(p, OJ_STRING, &p->buf);
+}
+
+static void open_container(ojParser p, char tag) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+
+    member(td);
+    if (td->end <= td->tail) {
+        size_t cap = td->end - td->head;
+        long   pos = td->tail - td->head;
+
+        cap *= 2;
+        OJ_R_REALLOC_N(td->head, struct _frame, cap);
+        td->tail = td->head + pos;
+        td->end  = td->head + cap;
+    }
+    td->tail->at  = td->data->wlen;
+    td->tail->cnt = 0;
+    td->tail++;
+    *push_words(td->data, 2) = TAPE_WORD(tag, 0);
+}
+
+static void close_container(ojParser p) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+    TapeData     d  = td->data;
+    Frame        f  = --td->tail;
+
+    d->words[f->at] |= d->wlen;
+    d->words[f->at + 1] = f->cnt;
+}
+
+static void open_array(ojParser p) {
+    open_container(p, TAPE_ARRAY);
+}
+
+static void open_object(ojParser p) {
+    open_container(p, TAPE_OBJECT);
+}
+
+static void add_null_key(ojParser p) {
+    add_key(p);
+    add_null(p);
+}
+
+static void add_true_key(ojParser p) {
+    add_key(p);
+    add_true(p);
+}
+
+static void add_false_key(ojParser p) {
+    add_key(p);
+    add_false(p);
+}
+
+static void add_int_key(ojParser p) {
+    add_key(p);
+    add_int(p);
+}
+
+static void add_float_key(ojParser p) {
+    add_key(p);
+    add_float(p);
+}
+
+static void add_big_key(ojParser p) {
+    add_key(p);
+    add_big(p);
+}
+
+static void add_str_key(ojParser p) {
+    add_key(p);
+    add_str(p);
+}
+
+static void open_array_key(ojParser p) {
+    add_key(p);
+    open_array(p);
+}
+
+static void open_object_key(ojParser p) {
+    add_key(p);
+    open_object(p);
+}
+
+static void start(ojParser p) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+
+    if (NULL == td->data) {
+        td->data = OJ_R_ALLOC(struct _tapeData);
+        memset(td->data, 0, sizeof(struct _tapeData));
+    }
+    td->data->wlen = 0;
+    td->data->slen = 0;
+    td->tail       = td->head;
+    td->top        = 0;
+    push_words(td->data, TAPE_HEAD);
+}
+
+static VALUE tape_wrap(VALUE root, TapeData d, size_t at);
+
+static VALUE result(ojParser p) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+    TapeData     d  = td->data;
+    size_t       at = TAPE_HEAD;
+
+    switch (td->top) {
+    case 0: return Qnil;
+    case 1: break;
+    default:
+        // Like the usual delegate several documents are returned as an array.
+        d->words[0] = TAPE_WORD(TAPE_ARRAY, d->wlen);
+        d->words[1] = td->top;
+        at          = 0;
+        break;
+    }
+    // The tape now belongs to the Oj::Tape and the next parse starts a new
+    // one.
+    td->data = NULL;
+
+    return tape_wrap(Qnil, d, at);
+}
+
+static VALUE option(ojParser p, const char *key, VALUE value) {
+    rb_raise(rb_eArgError, "%s is not an option for the tape delegate", key);
+    return Qnil;
+}
+
+static void dfree(ojParser p) {
+    TapeDelegate td = (TapeDelegate)p->ctx;
+
+    data_free(td->data);
+    OJ_R_FREE(td->head);
+    OJ_R_FREE(p->ctx);
+}
+
+static void mark(ojParser p) {
+}
+
+void oj_set_parser_tape(ojParser p) {
+    TapeDelegate td = OJ_R_ALLOC(struct _tapeDelegate);
+    Funcs        f;
+
+    td->data = NULL;
+    td->head = OJ_R_ALLOC_N(struct _frame, 64);
+    td->tail = td->head;
+    td->end  = td->head + 64;
+    td->top  = 0;
+    p->ctx   = (void *)td;
+
+    f               = p->funcs + TOP_FUN;
+    f->add_null     = add_null;
+    f->add_true     = add_true;
+    f->add_false    = add_false;
+    f->add_int      = add_int;
+    f->add_float    = add_float;
+    f->add_big      = add_big;
+    f->add_str      = add_str;
+    f->open_array   = open_array;
+    f->close_array  = close_container;
+    f->open_object  = open_object;
+    f->close_object = close_container;
+
+    p->funcs[ARRAY_FUN] = *f;
+
+    f               = p->funcs + OBJECT_FUN;
+    f->add_null     = add_null_key;
+    f->add_true     = add_true_key;
+    f->add_false    = add_false_key;
+    f->add_int      = add_int_key;
+    f->add_float    = add_float_key;
+    f->add_big      = add_big_key;
+    f->add_str      = add_str_key;
+    f->open_array   = open_array_key;
+    f->close_array  = close_container;
+    f->open_object  = open_object_key;
+    f->close_object = close_container;
+
+    p->option = option;
+    p->result = result;
+    p->free   = dfree;
+    p->mark   = mark;
+    p->start  = start;
+
+    // Only result() makes a Ruby object so large documents are parsed
+    // without holding the GVL.
+    p->gvl_free = true;
+}
+
+///// Oj::Tape
+
+static void tape_mark(void *ptr) {
+    Tape t = (Tape)ptr;
+
+    if (NULL != t && Qnil != t->root) {
+        rb_gc_mark(t->root);
+    }
+}
+
+static void tape_free(void *ptr) {
+    Tape t = (Tape)ptr;
+
+    if (NULL != t) {
+        if (Qnil == t->root) {
+            data_free(t->data);
+        }
+        OJ_R_FREE(t);
+    }
+}
+
+static size_t tape_size(const void *ptr) {
+    const Tape t = (const Tape)ptr;
+
+    if (NULL == t || Qnil != t->root) {
+        return sizeof(struct _tape);
+    }
+    return sizeof(struct _tape) + sizeof(struct _tapeData) + t->data->wcap * sizeof(uint64_t) + t->data->scap;
+}
+
+static const rb_data_type_t oj_tape_type = {
+    "Oj/tape",
+    {
+        tape_mark,
+        tape_free,
+        tape_size,
+    },
+    0,
+    0,
+};
+
+// A root owns the data and has a nil root. Views of members share the data
+// and keep the root alive.
+static VALUE tape_wrap(VALUE root, TapeData d, size_t at) {
+    Tape t = OJ_R_ALLOC(struct _tape);
+
+    t->root = root;
+    t->data = d;
+    t->at   = at;
+
+    return TypedData_Wrap_Struct(tape_class, &oj_tape_type, t);
+}
+
+static inline size_t entry_next(TapeData d, size_t i) {
+    switch (TAPE_TAG(d->words[i])) {
+    case OJ_NULL:
+    case OJ_TRUE:
+    case OJ_FALSE: return i + 1;
+    case TAPE_ARRAY:
+    case TAPE_OBJECT: return TAPE_PAYLOAD(d->words[i]);
+    default: return i + 2;
+    }
+}
+
+static VALUE entry_str(TapeData d, size_t i) {
+    return rb_utf8_str_new(d->str + TAPE_PAYLOAD(d->words[i]), (long)d->words[i + 1]);
+}
+
+// Returns the Ruby value for a scalar or a view for an array or object.
+static VALUE entry_value(VALUE self, Tape t, size_t i) {
+    TapeData d = t->data;
+    uint64_t w = d->words[i];
+    double   dub;
+
+    switch (TAPE_TAG(w)) {
+    case OJ_NULL: return Qnil;
+    case OJ_TRUE: return Qtrue;
+    case OJ_FALSE: return Qfalse;
+    case OJ_INT: return LL2NUM((int64_t)d->words[i + 1]);
+    case OJ_DECIMAL: memcpy(&dub, d->words + i + 1, sizeof(dub)); return rb_float_new(dub);
+    case OJ_BIG: return rb_funcall(rb_cObject, oj_bigdecimal_id, 1, entry_str(d, i));
+    case OJ_STRING: return entry_str(d, i);
+    default: return tape_wrap(Qnil == t->root ? self : t->root, d, i);
+    }
+}
+
+static VALUE entry_ruby(TapeData d, size_t i) {
+    uint64_t w = d->words[i];
+    size_t   end;
+
+    switch (TAPE_TAG(w)) {
+    case TAPE_ARRAY: {
+        volatile VALUE a = rb_ary_new_capa((long)d->words[i + 1]);
+
+        for (end = TAPE_PAYLOAD(w), i += 2; i < end; i = entry_next(d, i)) {
+            rb_ary_push(a, entry_ruby(d, i));
+        }
+        return a;
+    }
+    case TAPE_OBJECT: {
+        volatile VALUE h = rb_hash_new();
+
+        for (end = TAPE_PAYLOAD(w), i += 2; i < end; i = entry_next(d, i + 2)) {
+            volatile VALUE key = rb_str_freeze(entry_str(d, i));
+
+            rb_hash_aset(h, key, entry_ruby(d, i + 2));
+        }
+        return h;
+    }
+    case OJ_NULL: return Qnil;
+    case OJ_TRUE: return Qtrue;
+    case OJ_FALSE: return Qfalse;
+    case OJ_INT: return LL2NUM((int64_t)d->words[i + 1]);
+    case OJ_DECIMAL: {
+        double dub;
+
+        memcpy(&dub, d->words + i + 1, sizeof(dub));
+        return rb_float_new(dub);
+    }
+    case OJ_BIG: return rb_funcall(rb_cObject, oj_bigdecimal_id, 1, entry_str(d, i));
+    case OJ_STRING: return entry_str(d, i);
+    default: break;
+    }
+    return Qnil;
+}
+
+// Returns the index of the member or 0 if there is no such member. Object
+// members are looked up by String or Symbol and array members by Integer.
+static size_t entry_member(Tape t, VALUE key) {
+    TapeData d   = t->data;
+    uint64_t w   = d->words[t->at];
+    size_t   end = TAPE_PAYLOAD(w);
+    size_t   i   = t->at + 2;
+
+    switch (TAPE_TAG(w)) {
+    case TAPE_ARRAY: {
+        long cnt = (long)d->words[t->at + 1];
+        long n   = NUM2LONG(key);
+
+        if (n < 0) {
+            n += cnt;
+        }
+        if (n < 0 || cnt <= n) {
+            return 0;
+        }
+        for (; 0 < n; n--) {
+            i = entry_next(d, i);
+        }
+        return i;
+    }
+    case TAPE_OBJECT: {
+        const char *ks;
+        size_t      klen;
+
+        if (RB_TYPE_P(key, T_SYMBOL)) {
+            key = rb_sym2str(key);
+        }
+        StringValue(key);
+        ks   = RSTRING_PTR(key);
+        klen = (size_t)RSTRING_LEN(key);
+        for (; i < end; i = entry_next(d, i + 2)) {
+            if (klen == d->words[i + 1] && 0 == memcmp(ks, d->str + TAPE_PAYLOAD(d->words[i]), klen)) {
+                return i + 2;
+            }
+        }
+        return 0;
+    }
+    default: break;
+    }
+    return 0;
+}
+
+/* Document-method: []
+ * call-seq: [](key)
+ *
+ * Returns the member of an object with the _key_ [_String_|_Symbol_] or of an
+ * array at the _index_ [_Integer_]. Strings, numbers, and literals are
+ * returned as Ruby values while arrays and objects are returned as an
+ * Oj::Tape that shares the parsed document. Returns nil if there is no such
+ * member.
+ */
+static VALUE tape_get(VALUE self, VALUE key) {
+    Tape   t;
+    size_t i;
+
+    TypedData_Get_Struct(self, struct _tape, &oj_tape_type, t);
+
+    if (0 == (i = entry_member(t, key))) {
+        return Qnil;
+    }
+    return entry_value(self, t, i);
+}
+
+/* Document-method: dig
+ * call-seq: dig(*keys)
+ *
+ * Follows the _keys_ into nested arrays and objects the same way as
+ * Hash#dig. Returns nil if a member is missing.
+ */
+static VALUE tape_dig(int argc, VALUE *argv, VALUE self) {
+    VALUE v = self;
+    int   i;
+
+    for (i = 0; i < argc; i++) {
+        if (!rb_obj_is_kind_of(v, tape_class)) {
+            if (Qnil == v) {
+                return Qnil;
+            }
+            rb_raise(rb_eTypeError, "%s does not have #dig method", rb_obj_classname(v));
+        }
+        v = tape_get(v, argv[i]);
+    }
+    return v;
+}
+
+/* Document-method: each
+ * call-seq: each() { |key, value| ... }
+ *
+ * Yields each key and value of an object or each value of an array. Arrays
+ * and objects are yielded as an Oj::Tape.
+ */
+static VALUE tape_each(VALUE self) {
+    Tape     t;
+    TapeData d;
+    uint64_t w;
+    size_t   end;
+    size_t   i;
+
+    RETURN_ENUMERATOR(self, 0, 0);
+    TypedData_Get_Struct(self, struct _tape, &oj_tape_type, t);
+
+    d   = t->data;
+    w   = d->words[t->at];
+    end = TAPE_PAYLOAD(w);
+    switch (TAPE_TAG(w)) {
+    case TAPE_ARRAY:
+        for (i = t->at + 2; i < end; i = entry_next(d, i)) {
+            rb_yield(entry_value(self, t, i));
+        }
+        break;
+    case TAPE_OBJECT:
+        for (i = t->at + 2; i < end; i = entry_next(d, i + 2)) {
+            rb_yield_values(2, rb_str_freeze(entry_str(d, i)), entry_value(self, t, i + 2));
+        }
+        break;
+    default: break;
+    }
+    return self;
+}
+
+/* Document-method: size
+ * call-seq: size()
+ *
+ * Returns the number of members of an array or object or 0 otherwise.
+ */
+static VALUE tape_member_count(VALUE self) {
+    Tape t;
+
+    TypedData_Get_Struct(self, struct _tape, &oj_tape_type, t);
+
+    switch (TAPE_TAG(t->data->words[t->at])) {
+    case TAPE_ARRAY:
+    case TAPE_OBJECT: return ULONG2NUM((unsigned long)t->data->words[t->at + 1]);
+    default: break;
+    }
+    return INT2FIX(0);
+}
+
+/* Document-method: to_ruby
+ * call-seq: to_ruby()
+ *
+ * Returns the Ruby Hash, Array, or value for the tape. The result is the same
+ * as what the usual delegate with default options would have returned.
+ */
+static VALUE tape_to_ruby(VALUE self) {
+    Tape t;
+
+    TypedData_Get_Struct(self, struct _tape, &oj_tape_type, t);
+
+    return entry_ruby(t->data, t->at);
+}
+
+/* Document-class: Oj::Tape
+ *
+ * The result of parsing with the tape delegate. A tape is a compact record of
+ * a JSON document that creates Ruby objects only for the members that are
+ * read.
+ */
+void oj_tape_init(void) {
+    tape_class = rb_define_class_under(Oj, "Tape", rb_cObject);
+    rb_gc_register_address(&tape_class);
+    rb_undef_alloc_func(tape_class);
+
+    rb_define_method(tape_class, "[]", tape_get, 1);
+    rb_define_method(tape_class, "dig", tape_dig, -1);
+    rb_define_method(tape_class, "each", tape_each, 0);
+    rb_define_method(tape_class, "size", tape_member_count, 0);
+    rb_define_method(tape_class, "to_ruby", tape_to_ruby, 0);
+}
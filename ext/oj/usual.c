@@ -5,6 +5,7 @@
 #include "cache.h"
 #include "mem.h"
 #include "oj.h"
+#include "only.h"
 #include "parser.h"
 
 // The Usual delegate builds Ruby objects during parsing. It makes use of
@@ -35,6 +36,16 @@ static ID to_f_id = 0;
 static ID ltlt_id = 0;
 static ID hset_id = 0;
 
+// Returns a Hash with room for cnt members so it is not grown as the members
+// are inserted.
+static VALUE hash_new(long cnt) {
+#if HAVE_RB_HASH_NEW_CAPA
+    return rb_hash_new_capa(cnt);
+#else
+    return rb_hash_new();
+#endif
+}
+
 static char *str_dup(const char *s, size_t len) {
     char *d = OJ_R_ALLOC_N(char, len + 1);
 
@@ -160,21 +171,25 @@ static VALUE cache_key(ojParser p, Key kp) {
     if ((size_t)kp->len < sizeof(kp->buf)) {
         return cache_intern(d->key_cache, kp->buf, kp->len);
     }
-    return cache_intern(d->key_cache, kp->key, kp->len);
+    return cache_intern(d->key_cache, d->ahead + kp->off, kp->len);
 }
 
 static VALUE str_key(ojParser p, Key kp) {
+    Usual d = (Usual)p->ctx;
+
     if ((size_t)kp->len < sizeof(kp->buf)) {
         return rb_str_freeze(rb_utf8_str_new(kp->buf, kp->len));
     }
-    return rb_str_freeze(rb_utf8_str_new(kp->key, kp->len));
+    return rb_str_freeze(rb_utf8_str_new(d->ahead + kp->off, kp->len));
 }
 
 static VALUE sym_key(ojParser p, Key kp) {
+    Usual d = (Usual)p->ctx;
+
     if ((size_t)kp->len < sizeof(kp->buf)) {
         return rb_str_freeze(rb_str_intern(rb_utf8_str_new(kp->buf, kp->len)));
     }
-    return rb_str_freeze(rb_str_intern(rb_utf8_str_new(kp->key, kp->len)));
+    return rb_str_freeze(rb_str_intern(rb_utf8_str_new(d->ahead + kp->off, kp->len)));
 }
 
 static ID get_attr_id(ojParser p, Key kp) {
@@ -183,7 +198,141 @@ static ID get_attr_id(ojParser p, Key kp) {
     if ((size_t)kp->len < sizeof(kp->buf)) {
         return (ID)cache_intern(d->attr_cache, kp->buf, kp->len);
     }
-    return (ID)cache_intern(d->attr_cache, kp->key, kp->len);
+    return (ID)cache_intern(d->attr_cache, d->ahead + kp->off, kp->len);
+}
+
+// Arrays of records with the same members are common so the keys of recently
+// closed objects are remembered as shapes. An object with the same keys in
+// the same order as the shape in its slot takes what was looked up for the
+// keys from the shape after one comparison per key instead of a cache lookup
+// per key. One table holds the key VALUEs of Hashes and another the attribute
+// IDs of create_id Objects. Attribute IDs are never collected so only the
+// first table is marked.
+#define SHAPE_SLOTS 64
+#define SHAPE_MAX_KEYS 32
+#define SHAPE_MAX_BYTES 512
+
+typedef struct _shape {
+    long    cnt;     // 0 for an empty slot
+    long    misses;  // objects that did not match since the last match
+    int16_t lens[SHAPE_MAX_KEYS];
+    VALUE   keys[SHAPE_MAX_KEYS];    // VALUEs or IDs
+    char    bytes[SHAPE_MAX_BYTES];  // the keys one after the other
+} *Shape;
+
+static const char *key_str(Usual d, Key kp) {
+    if ((size_t)kp->len < sizeof(kp->buf)) {
+        return kp->buf;
+    }
+    return d->ahead + kp->off;
+}
+
+static void shapes_clear(Shape table) {
+    if (NULL != table) {
+        memset(table, 0, sizeof(struct _shape) * SHAPE_SLOTS);
+    }
+}
+
+// Sets what get returns for each key of the object whose keys start at kp
+// into out, stepping by step. The object must have 1 to SHAPE_MAX_KEYS keys.
+static void shape_fill(ojParser p, Shape *tablep, Key kp, VALUE *out, int step, VALUE (*get)(ojParser p, Key kp)) {
+    Usual       d   = (Usual)p->ctx;
+    long        cnt = d->ktail - kp;
+    Shape       s;
+    Key         k;
+    VALUE      *v;
+    const char *b;
+    char       *w;
+    long        i;
+
+    if (NULL == *tablep) {
+        *tablep = OJ_R_ALLOC_N(struct _shape, SHAPE_SLOTS);
+        shapes_clear(*tablep);
+    }
+    s = *tablep + ((cnt * 7 + kp->len * 3 + (d->ktail - 1)->len + (uint8_t)*key_str(d, kp)) & (SHAPE_SLOTS - 1));
+    if (cnt == s->cnt) {
+        b = s->bytes;
+        for (i = 0, k = kp, v = out; i < cnt; i++, k++, v += step) {
+            if (k->len != s->lens[i] || 0 != memcmp(key_str(d, k), b, k->len)) {
+                break;
+            }
+            *v = s->keys[i];
+            b += k->len;
+        }
+        if (i == cnt) {
+            s->misses = 0;
+            return;
+        }
+    }
+    // A shape that was matching is only replaced after a second miss in a
+    // row so objects of different shapes in the same slot do not replace
+    // each other every time.
+    if (0 != s->cnt && 0 == s->misses++) {
+        for (k = kp, v = out; k < d->ktail; k++, v += step) {
+            *v = get(p, k);
+        }
+        return;
+    }
+    // Look up each key and make the object the shape for the slot if the
+    // keys fit.
+    s->cnt    = 0;
+    s->misses = 0;
+    w         = s->bytes;
+    for (i = 0, k = kp, v = out; i < cnt; i++, k++, v += step) {
+        *v = get(p, k);
+        if (NULL != w) {
+            if (s->bytes + sizeof(s->bytes) - w < k->len) {
+                w = NULL;
+                continue;
+            }
+            memcpy(w, key_str(d, k), k->len);
+            s->lens[i] = k->len;
+            s->keys[i] = *v;
+            w += k->len;
+        }
+    }
+    if (NULL != w) {
+        s->cnt = cnt;
+    }
+}
+
+// Sets the keys of the object whose keys start at kp into every other slot
+// of the value stack starting at vp.
+static void fill_keys(ojParser p, Key kp, VALUE *vp) {
+    Usual d   = (Usual)p->ctx;
+    long  cnt = d->ktail - kp;
+
+    if (cache_key != d->get_key || 0 == cnt || SHAPE_MAX_KEYS < cnt) {
+        for (; kp < d->ktail; kp++, vp += 2) {
+            *vp = d->get_key(p, kp);
+        }
+        return;
+    }
+    shape_fill(p, &d->shapes, kp, vp, 2, cache_key);
+}
+
+static VALUE attr_key(ojParser p, Key kp) {
+    return (VALUE)get_attr_id(p, kp);
+}
+
+// Sets the members of obj to the values that follow the keys on the value
+// stack starting at vp.
+static void set_attrs(ojParser p, VALUE obj, Key kp, VALUE *vp) {
+    Usual d   = (Usual)p->ctx;
+    long  cnt = d->ktail - kp;
+    VALUE ids[SHAPE_MAX_KEYS];
+    long  i;
+
+    if (0 == cnt || SHAPE_MAX_KEYS < cnt) {
+        for (; kp < d->ktail; kp++, vp += 2) {
+            rb_ivar_set(obj, get_attr_id(p, kp), *(vp + 1));
+        }
+        return;
+    }
+    shape_fill(p, &d->attr_shapes, kp, ids, 1, attr_key);
+    for (i = 0; i < cnt; i++, vp += 2) {
+        rb_ivar_set(obj, (ID)ids[i], *(vp + 1));
+    }
 }
 
 static void push_key(ojParser p) {
@@ -208,7 +357,20 @@ static void push_key(ojParser p) {
         memcpy(d->ktail->buf, key, klen);
         d->ktail->buf[klen] = '\0';
     } else {
-        d->ktail->key = str_dup(key, klen);
+        if (d->aend < d->atail + klen) {
+            size_t cap = d->aend - d->ahead;
+            long   pos = d->atail - d->ahead;
+
+            while (cap < pos + klen) {
+                cap *= 2;
+            }
+            OJ_R_REALLOC_N(d->ahead, char, cap);
+            d->atail = d->ahead + pos;
+            d->aend  = d->ahead + cap;
+        }
+        memcpy(d->atail, key, klen);
+        d->ktail->off = d->atail - d->ahead;
+        d->atail += klen;
     }
     d->ktail++;
 }
@@ -237,6 +399,7 @@ static void open_object(ojParser p) {
     assure_cstack(d);
     d->ctail->vi = d->vtail - d->vhead;
     d->ctail->ki = d->ktail - d->khead;
+    d->ctail->ai = d->atail - d->ahead;
     d->ctail++;
     push(p, Qundef);
 }
@@ -248,6 +411,7 @@ static void open_object_key(ojParser p) {
     assure_cstack(d);
     d->ctail->vi = d->vtail - d->vhead + 1;
     d->ctail->ki = d->ktail - d->khead;
+    d->ctail->ai = d->atail - d->ahead;
     d->ctail++;
     push2(p, Qundef);
 }
@@ -274,29 +438,24 @@ static void open_array_key(ojParser p) {
 }
 
 static void close_object(ojParser p) {
-    VALUE *vp;
-    Usual  d = (Usual)p->ctx;
+    Usual d = (Usual)p->ctx;
 
     d->ctail--;
 
     Col            c    = d->ctail;
     Key            kp   = d->khead + c->ki;
     VALUE         *head = d->vhead + c->vi + 1;
-    volatile VALUE obj  = rb_hash_new();
+    volatile VALUE obj  = hash_new((d->vtail - head) / 2);
 
-    for (vp = head; kp < d->ktail; kp++, vp += 2) {
-        *vp = d->get_key(p, kp);
-        if (sizeof(kp->buf) <= (size_t)kp->len) {
-            OJ_R_FREE(kp->key);
-        }
-    }
+    fill_keys(p, kp, head);
     rb_hash_bulk_insert(d->vtail - head, head, obj);
     d->ktail = d->khead + c->ki;
+    d->atail = d->ahead + c->ai;
 
     d->vtail = head;
     head--;
     *head = obj;
-    if (1 == d->vtail - d->vhead && rb_block_given_p()) {
+    if (1 == d->vtail - d->vhead && !p->no_yield && rb_block_given_p()) {
         d->vtail = d->vhead;
         rb_yield(obj);
     }
@@ -315,11 +474,9 @@ static void close_object_class(ojParser p) {
 
     for (vp = head; kp < d->ktail; kp++, vp += 2) {
         rb_funcall(obj, hset_id, 2, d->get_key(p, kp), *(vp + 1));
-        if (sizeof(kp->buf) <= (size_t)kp->len) {
-            OJ_R_FREE(kp->key);
-        }
     }
     d->ktail = d->khead + c->ki;
+    d->atail = d->ahead + c->ai;
     d->vtail = head;
     head--;
     *head = obj;
@@ -339,21 +496,13 @@ static void close_object_create(ojParser p) {
     if (Qundef == *head) {
         head++;
         if (Qnil == d->hash_class) {
-            obj = rb_hash_new();
-            for (vp = head; kp < d->ktail; kp++, vp += 2) {
-                *vp = d->get_key(p, kp);
-                if (sizeof(kp->buf) <= (size_t)kp->len) {
-                    OJ_R_FREE(kp->key);
-                }
-            }
+            obj = hash_new((d->vtail - head) / 2);
+            fill_keys(p, kp, head);
             rb_hash_bulk_insert(d->vtail - head, head, obj);
         } else {
             obj = rb_class_new_instance(0, NULL, d->hash_class);
             for (vp = head; kp < d->ktail; kp++, vp += 2) {
                 rb_funcall(obj, hset_id, 2, d->get_key(p, kp), *(vp + 1));
-                if (sizeof(kp->buf) <= (size_t)kp->len) {
-                    OJ_R_FREE(kp->key);
-                }
             }
         }
     } else {
@@ -361,27 +510,18 @@ static void close_object_create(ojParser p) {
 
         head++;
         if (!d->ignore_json_create && rb_respond_to(clas, oj_json_create_id)) {
-            volatile VALUE arg = rb_hash_new();
+            volatile VALUE arg = hash_new((d->vtail - head) / 2);
 
-            for (vp = head; kp < d->ktail; kp++, vp += 2) {
-                *vp = d->get_key(p, kp);
-                if (sizeof(kp->buf) <= (size_t)kp->len) {
-                    OJ_R_FREE(kp->key);
-                }
-            }
+            fill_keys(p, kp, head);
             rb_hash_bulk_insert(d->vtail - head, head, arg);
             obj = rb_funcall(clas, oj_json_create_id, 1, arg);
         } else {
             obj = rb_class_new_instance(0, NULL, clas);
-            for (vp = head; kp < d->ktail; kp++, vp += 2) {
-                rb_ivar_set(obj, get_attr_id(p, kp), *(vp + 1));
-                if (sizeof(kp->buf) <= (size_t)kp->len) {
-                    OJ_R_FREE(kp->key);
-                }
-            }
+            set_attrs(p, obj, kp, head);
         }
     }
     d->ktail = d->khead + c->ki;
+    d->atail = d->ahead + c->ai;
     d->vtail = head;
     head--;
     *head = obj;
@@ -516,8 +656,8 @@ static void add_big_as_ruby_key(ojParser p) {
 static void add_str(ojParser p) {
     Usual          d = (Usual)p->ctx;
     volatile VALUE rstr;
-    const char    *str = buf_str(&p->buf);
-    size_t         len = buf_len(&p->buf);
+    const char    *str = p->str;
+    size_t         len = p->str_len;
 
     if (len < d->cache_str) {
         rstr = cache_intern(d->str_cache, str, len);
@@ -530,8 +670,8 @@ static void add_str(ojParser p) {
 static void add_str_key(ojParser p) {
     Usual          d = (Usual)p->ctx;
     volatile VALUE rstr;
-    const char    *str = buf_str(&p->buf);
-    size_t         len = buf_len(&p->buf);
+    const char    *str = p->str;
+    size_t         len = p->str_len;
 
     if (len < d->cache_str) {
         rstr = cache_intern(d->str_cache, str, len);
@@ -545,8 +685,8 @@ static void add_str_key(ojParser p) {
 static void add_str_key_create(ojParser p) {
     Usual          d = (Usual)p->ctx;
     volatile VALUE rstr;
-    const char    *str  = buf_str(&p->buf);
-    size_t         len  = buf_len(&p->buf);
+    const char    *str  = p->str;
+    size_t         len  = p->str_len;
     const char    *key  = buf_str(&p->key);
     size_t         klen = buf_len(&p->key);
 
@@ -564,7 +704,7 @@ static void add_str_key_create(ojParser p) {
             return;
         }
         if (MISS_RAISE == d->miss_class) {
-            rb_raise(rb_eLoadError, "%s is not define", str);
+            rb_raise(rb_eLoadError, "%.*s is not define", (int)len, str);
         }
     }
     if (len < d->cache_str) {
@@ -580,18 +720,12 @@ static VALUE result(ojParser p) {
     Usual d = (Usual)p->ctx;
 
     if (d->vhead < d->vtail) {
-        long            cnt = d->vtail - d->vhead;
-        volatile VALUE  ary;
-        volatile VALUE *vp;
+        long cnt = d->vtail - d->vhead;
 
         if (1 == cnt) {
             return *d->vhead;
         }
-        ary = rb_ary_new();
-        for (vp = d->vhead; vp < d->vtail; vp++) {
-            rb_ary_push(ary, *vp);
-        }
-        return ary;
+        return rb_ary_new_from_values(cnt, d->vhead);
     }
     if (d->raise_on_empty) {
         rb_raise(oj_parse_error_class, "empty string");
@@ -599,12 +733,598 @@ static VALUE result(ojParser p) {
     return Qnil;
 }
 
+///// only ////////////////////////////////////////////////////////////////////
+
+// The only option limits the values built to those on a list of paths as
+// described in only.h. Members off every path are not built at all and
+// arrays and objects off every path are skipped.
+
+#define ONLY_ADD(name)                                                \
+    static void only_##name(ojParser p) {                             \
+        Only o = ((Usual)p->ctx)->only;                               \
+                                                                      \
+        if (oj_only_keep(p, o, false)) {                              \
+            o->funcs[p->stack[p->depth]].name(p);                     \
+        }                                                             \
+    }
+
+ONLY_ADD(add_null)
+ONLY_ADD(add_true)
+ONLY_ADD(add_false)
+ONLY_ADD(add_int)
+ONLY_ADD(add_float)
+ONLY_ADD(add_big)
+ONLY_ADD(add_str)
+
+static void only_open_array(ojParser p) {
+    Only o = ((Usual)p->ctx)->only;
+
+    if (oj_only_keep(p, o, true)) {
+        o->funcs[p->stack[p->depth]].open_array(p);
+    } else {
+        p->skip = 1;
+    }
+}
+
+static void only_open_object(ojParser p) {
+    Only o = ((Usual)p->ctx)->only;
+
+    if (oj_only_keep(p, o, true)) {
+        o->funcs[p->stack[p->depth]].open_object(p);
+    } else {
+        p->skip = 1;
+    }
+}
+
+// Like the safe delegate, the option setters write to the parser function
+// table so the wrappers are taken out while an option is called and put
+// back afterwards.
+#define ONLY_WRAP(slot)                  \
+    do {                                 \
+        if (only_##slot != f->slot) {    \
+            saved->slot = f->slot;       \
+        }                                \
+        f->slot = only_##slot;           \
+    } while (0)
+
+static void only_wrap(ojParser p, Only o) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        Funcs f     = p->funcs + i;
+        Funcs saved = o->funcs + i;
+
+        saved->close_array  = f->close_array;
+        saved->close_object = f->close_object;
+        ONLY_WRAP(add_null);
+        ONLY_WRAP(add_true);
+        ONLY_WRAP(add_false);
+        ONLY_WRAP(add_int);
+        ONLY_WRAP(add_float);
+        ONLY_WRAP(add_big);
+        ONLY_WRAP(add_str);
+        ONLY_WRAP(open_array);
+        ONLY_WRAP(open_object);
+    }
+}
+
+static void only_unwrap(ojParser p, Only o) {
+    memcpy(p->funcs, o->funcs, sizeof(o->funcs));
+}
+
+static VALUE opt_only(ojParser p, VALUE value) {
+    Usual d = (Usual)p->ctx;
+
+    return (NULL == d->only) ? Qnil : d->only->list;
+}
+
+static VALUE opt_only_set(ojParser p, VALUE value) {
+    Usual          d    = (Usual)p->ctx;
+    volatile VALUE list = Qnil;
+
+    // Check the new list before the current one is dropped.
+    if (Qnil != value) {
+        list = oj_only_list(p, value, "only");
+    }
+    if (NULL != d->only) {
+        oj_only_free(d->only);
+        d->only = NULL;
+    }
+    if (Qnil != list) {
+        d->only = oj_only_create(list);
+    }
+    return list;
+}
+
+///// struct_class ////////////////////////////////////////////////////////////
+
+// The struct_class option maps paths, the same JSON Pointers used by the only
+// option, to Struct or Data classes. Objects on one of those paths are built
+// by passing the values to new in member order so no Hash is made first.
+//
+// The member names of each class are looked up once when the option is set.
+// Keys usually arrive in member order so the member at the same position is
+// checked first before the rest are scanned. Keys that are not members are
+// ignored and members without a key are nil.
+//
+// The path of an object is taken from the container stack when it closes.
+// An array index is the position in the value stack so with the only option
+// an index counts only the elements that were kept.
+
+typedef struct _structMember {
+    const char *str;
+    size_t      len;
+} *StructMember;
+
+typedef struct _structClass {
+    struct _onlyPath     path;
+    VALUE                clas;
+    bool                 data;  // Data.new takes the place of allocate and initialize
+    int                  cnt;
+    struct _structMember members[];
+} *StructClass;
+
+typedef struct _structs {
+    StructClass classes[ONLY_MAX];
+    int         cnt;
+    VALUE       map;                 // frozen copy of the option value
+    void (*close_object)(ojParser p);  // the close used when no path matches
+    VALUE *argv;
+    int    argc;  // capacity of argv
+} *Structs;
+
+static ID new_id = 0;
+
+static void structs_free(Structs s) {
+    int i;
+
+    for (i = 0; i < s->cnt; i++) {
+        OJ_R_FREE(s->classes[i]->path.segs);
+        OJ_R_FREE(s->classes[i]);
+    }
+    OJ_R_FREE(s->argv);
+    OJ_R_FREE(s);
+}
+
+// Returns true if the value at vi in the value stack, a member of the
+// container at depth - 1 in the container stack, is on the path. Each
+// segment is compared from the deepest up as the last segments are the most
+// likely to differ.
+static bool path_match(Usual d, long depth, long vi, OnlyPath op) {
+    if (op->cnt != depth) {
+        return false;
+    }
+    for (; 0 < depth; depth--) {
+        OnlySeg s      = op->segs + depth - 1;
+        Col     parent = d->chead + depth - 1;
+
+        if (!s->any) {
+            if (parent->ki < 0) {
+                if (s->index != vi - parent->vi - 1) {
+                    return false;
+                }
+            } else {
+                Key kp = d->khead + parent->ki + (vi - parent->vi - 2) / 2;
+
+                if ((size_t)kp->len != s->len || 0 != memcmp(key_str(d, kp), s->str, s->len)) {
+                    return false;
+                }
+            }
+        }
+        vi = parent->vi;
+    }
+    return true;
+}
+
+static int struct_member(StructClass sc, int pos, const char *key, size_t len) {
+    StructMember m;
+
+    if (pos < sc->cnt) {
+        m = sc->members + pos;
+        if (m->len == len && 0 == memcmp(m->str, key, len)) {
+            return pos;
+        }
+    }
+    for (m = sc->members; m < sc->members + sc->cnt; m++) {
+        if (m->len == len && 0 == memcmp(m->str, key, len)) {
+            return (int)(m - sc->members);
+        }
+    }
+    return -1;
+}
+
+static void close_object_struct(ojParser p) {
+    Usual          d  = (Usual)p->ctx;
+    Structs        s  = d->structs;
+    Col            c  = d->ctail - 1;
+    StructClass    sc = NULL;
+    Key            kp;
+    VALUE         *head;
+    VALUE         *vp;
+    volatile VALUE obj;
+    int            i;
+
+    for (i = 0; i < s->cnt; i++) {
+        if (path_match(d, c - d->chead, c->vi, &s->classes[i]->path)) {
+            sc = s->classes[i];
+            break;
+        }
+    }
+    if (NULL == sc) {
+        s->close_object(p);
+        return;
+    }
+    d->ctail--;
+    kp   = d->khead + c->ki;
+    head = d->vhead + c->vi + 1;
+    for (i = 0; i < sc->cnt; i++) {
+        s->argv[i] = Qnil;
+    }
+    // The values stay on the value stack until the instance is made so they
+    // are marked while argv holds them.
+    for (vp = head, i = 0; kp < d->ktail; kp++, vp += 2, i++) {
+        int m = struct_member(sc, i, key_str(d, kp), kp->len);
+
+        if (0 <= m) {
+            s->argv[m] = *(vp + 1);
+        }
+    }
+    if (sc->data) {
+        obj = rb_funcallv(sc->clas, new_id, sc->cnt, s->argv);
+    } else {
+        obj = rb_class_new_instance(sc->cnt, s->argv, sc->clas);
+    }
+    d->ktail = d->khead + c->ki;
+    d->atail = d->ahead + c->ai;
+    d->vtail = head;
+    head--;
+    *head = obj;
+    if (1 == d->vtail - d->vhead && !p->no_yield && rb_block_given_p()) {
+        d->vtail = d->vhead;
+        rb_yield(obj);
+    }
+}
+
+// Sets the close_object functions to match the create_id, hash_class, and
+// struct_class options.
+static void set_close_object(ojParser p) {
+    Usual d = (Usual)p->ctx;
+    void (*close)(ojParser p);
+    int i;
+
+    if (NULL != d->create_id) {
+        close = close_object_create;
+    } else if (Qnil != d->hash_class) {
+        close = close_object_class;
+    } else {
+        close = close_object;
+    }
+    if (NULL != d->structs) {
+        d->structs->close_object = close;
+        close                    = close_object_struct;
+    }
+    for (i = 0; i < 3; i++) {
+        p->funcs[i].close_object = close;
+    }
+}
+
+static VALUE data_class(void) {
+    ID    id = rb_intern("Data");
+    VALUE data;
+
+    if (!rb_const_defined(rb_cObject, id)) {
+        return Qnil;
+    }
+    data = rb_const_get(rb_cObject, id);
+    if (!RB_TYPE_P(data, T_CLASS) || !rb_respond_to(data, rb_intern("define"))) {
+        return Qnil;
+    }
+    return data;
+}
+
+// Returns true if clas is a Data class and raises if it is neither a Data
+// class nor a Struct class that takes positional arguments.
+static bool struct_class_check(VALUE clas, VALUE data) {
+    rb_check_type(clas, T_CLASS);
+    if (Qnil != data && Qtrue == rb_class_inherited_p(clas, data)) {
+        return true;
+    }
+    if (Qtrue != rb_class_inherited_p(clas, rb_cStruct)) {
+        rb_raise(rb_eArgError, "struct_class %s is not a Struct or Data class", rb_class2name(clas));
+    }
+    if (rb_respond_to(clas, rb_intern("keyword_init?")) && RTEST(rb_funcall(clas, rb_intern("keyword_init?"), 0))) {
+        rb_raise(rb_eArgError, "struct_class %s must not be keyword_init", rb_class2name(clas));
+    }
+    return false;
+}
+
+// The member names are kept in the same allocation as the class entry.
+static StructClass struct_class_new(VALUE path, VALUE clas, VALUE members, bool data) {
+    StructClass sc;
+    char       *str;
+    size_t      size;
+    long        cnt = RARRAY_LEN(members);
+    long        i;
+
+    size = sizeof(struct _structClass) + sizeof(struct _structMember) * cnt;
+    for (i = 0; i < cnt; i++) {
+        size += RSTRING_LEN(rb_sym2str(rb_ary_entry(members, i)));
+    }
+    sc       = (StructClass)OJ_R_ALLOC_N(char, size);
+    sc->clas = clas;
+    sc->data = data;
+    sc->cnt  = (int)cnt;
+    str      = (char *)(sc->members + cnt);
+    for (i = 0; i < cnt; i++) {
+        VALUE name = rb_sym2str(rb_ary_entry(members, i));
+
+        sc->members[i].str = str;
+        sc->members[i].len = RSTRING_LEN(name);
+        memcpy(str, RSTRING_PTR(name), RSTRING_LEN(name));
+        str += RSTRING_LEN(name);
+    }
+    oj_only_path(&sc->path, path);
+
+    return sc;
+}
+
+static VALUE opt_struct_class(ojParser p, VALUE value) {
+    Usual d = (Usual)p->ctx;
+
+    return (NULL == d->structs) ? Qnil : d->structs->map;
+}
+
+static VALUE opt_struct_class_set(ojParser p, VALUE value) {
+    Usual          d = (Usual)p->ctx;
+    Structs        s;
+    volatile VALUE map;
+    volatile VALUE pairs;
+    volatile VALUE info;
+    VALUE          data;
+    long           i;
+    long           j;
+
+    if (Qnil == value) {
+        if (NULL != d->structs) {
+            structs_free(d->structs);
+            d->structs = NULL;
+            set_close_object(p);
+        }
+        return Qnil;
+    }
+    rb_check_type(value, T_HASH);
+    if (ONLY_MAX < RHASH_SIZE(value)) {
+        rb_raise(rb_eArgError, "struct_class is limited to %d paths", ONLY_MAX);
+    }
+    if (0 == new_id) {
+        new_id = rb_intern("new");
+    }
+    // Everything that can raise is checked before anything is allocated or
+    // the current classes are dropped.
+    data  = data_class();
+    pairs = rb_funcall(value, rb_intern("to_a"), 0);
+    map   = rb_hash_new();
+    info  = rb_ary_new_capa(RARRAY_LEN(pairs));
+    for (i = 0; i < RARRAY_LEN(pairs); i++) {
+        VALUE pair    = rb_ary_entry(pairs, i);
+        VALUE path    = rb_ary_entry(pair, 0);
+        VALUE clas    = rb_ary_entry(pair, 1);
+        VALUE members;
+        bool  is_data;
+
+        oj_only_check(p, path, "struct_class");
+        is_data = struct_class_check(clas, data);
+        members = rb_funcall(clas, rb_intern("members"), 0);
+        rb_check_type(members, T_ARRAY);
+        for (j = 0; j < RARRAY_LEN(members); j++) {
+            rb_check_type(rb_ary_entry(members, j), T_SYMBOL);
+        }
+        path = rb_str_new_frozen(path);
+        rb_hash_aset(map, path, clas);
+        rb_ary_push(info, rb_ary_new_from_args(4, path, clas, members, is_data ? Qtrue : Qfalse));
+    }
+    rb_obj_freeze(map);
+    if (NULL != d->structs) {
+        structs_free(d->structs);
+        d->structs = NULL;
+    }
+    s = OJ_R_ALLOC(struct _structs);
+    memset(s, 0, sizeof(struct _structs));
+    s->map = map;
+    for (i = 0; i < RARRAY_LEN(info); i++) {
+        VALUE       a  = rb_ary_entry(info, i);
+        StructClass sc = struct_class_new(rb_ary_entry(a, 0), rb_ary_entry(a, 1), rb_ary_entry(a, 2), Qtrue == rb_ary_entry(a, 3));
+
+        s->classes[s->cnt++] = sc;
+        if (s->argc < sc->cnt) {
+            s->argc = sc->cnt;
+        }
+    }
+    s->argv    = OJ_R_ALLOC_N(VALUE, s->argc + 1);
+    d->structs = s;
+    set_close_object(p);
+
+    return map;
+}
+
+///// each_element ////////////////////////////////////////////////////////////
+
+// The each_element option yields each value on one of a list of paths to the
+// block given to parse or load as soon as the value is complete and then
+// drops it from the value stack, so a long array of records is never held
+// all at once. A path names the values themselves, "/*" being the members of
+// a top level array. A value dropped from an object takes its key with it.
+//
+// Array indexes are positions in the value stack so an index segment of a
+// path below an array that is being emptied by this option does not match
+// the document index.
+
+typedef struct _each {
+    struct _onlyPath paths[ONLY_MAX];
+    int              cnt;
+    VALUE            list;      // frozen copy of the option value
+    struct _funcs    funcs[3];  // the wrapped functions
+} *Each;
+
+static void each_free(Each e) {
+    int i;
+
+    for (i = 0; i < e->cnt; i++) {
+        OJ_R_FREE(e->paths[i].segs);
+    }
+    OJ_R_FREE(e);
+}
+
+// Called after a value has been pushed. If it is on a path it is popped,
+// along with its key if in an object, and yielded.
+static void each_yield(ojParser p) {
+    Usual d     = (Usual)p->ctx;
+    Each  e     = d->each;
+    long  depth = d->ctail - d->chead;
+    long  vi    = d->vtail - d->vhead - 1;
+    int   i;
+
+    if (p->no_yield || !rb_block_given_p()) {
+        return;
+    }
+    for (i = 0; i < e->cnt; i++) {
+        if (path_match(d, depth, vi, e->paths + i)) {
+            volatile VALUE v = *(d->vtail - 1);
+
+            d->vtail--;
+            if (0 <= (d->ctail - 1)->ki) {
+                d->vtail--;
+                d->ktail--;
+                if (sizeof(d->ktail->buf) <= (size_t)d->ktail->len) {
+                    d->atail = d->ahead + d->ktail->off;
+                }
+            }
+            rb_yield(v);
+            return;
+        }
+    }
+}
+
+#define EACH_ADD(name)                                                 \
+    static void each_##name(ojParser p) {                              \
+        Usual  d    = (Usual)p->ctx;                                   \
+        VALUE *tail = d->vtail;                                        \
+                                                                       \
+        d->each->funcs[p->stack[p->depth]].name(p);                    \
+        if (tail < d->vtail) {                                         \
+            each_yield(p);                                             \
+        }                                                              \
+    }
+
+EACH_ADD(add_null)
+EACH_ADD(add_true)
+EACH_ADD(add_false)
+EACH_ADD(add_int)
+EACH_ADD(add_float)
+EACH_ADD(add_big)
+EACH_ADD(add_str)
+
+static void each_close_array(ojParser p) {
+    ((Usual)p->ctx)->each->funcs[p->stack[p->depth]].close_array(p);
+    each_yield(p);
+}
+
+static void each_close_object(ojParser p) {
+    ((Usual)p->ctx)->each->funcs[p->stack[p->depth]].close_object(p);
+    each_yield(p);
+}
+
+// Only values in an array or object are wrapped. Top level values are
+// already yielded by the usual delegate.
+#define EACH_WRAP(slot)                  \
+    do {                                 \
+        if (each_##slot != f->slot) {    \
+            saved->slot = f->slot;       \
+        }                                \
+        f->slot = each_##slot;           \
+    } while (0)
+
+static void each_wrap(ojParser p, Each e) {
+    int i;
+
+    e->funcs[TOP_FUN] = p->funcs[TOP_FUN];
+    for (i = ARRAY_FUN; i <= OBJECT_FUN; i++) {
+        Funcs f     = p->funcs + i;
+        Funcs saved = e->funcs + i;
+
+        saved->open_array  = f->open_array;
+        saved->open_object = f->open_object;
+        EACH_WRAP(add_null);
+        EACH_WRAP(add_true);
+        EACH_WRAP(add_false);
+        EACH_WRAP(add_int);
+        EACH_WRAP(add_float);
+        EACH_WRAP(add_big);
+        EACH_WRAP(add_str);
+        EACH_WRAP(close_array);
+        EACH_WRAP(close_object);
+    }
+}
+
+static void each_unwrap(ojParser p, Each e) {
+    memcpy(p->funcs, e->funcs, sizeof(e->funcs));
+}
+
+static VALUE opt_each_element(ojParser p, VALUE value) {
+    Usual d = (Usual)p->ctx;
+
+    return (NULL == d->each) ? Qnil : d->each->list;
+}
+
+// The wrappers are put in place by option() after this returns.
+static VALUE opt_each_element_set(ojParser p, VALUE value) {
+    Usual          d = (Usual)p->ctx;
+    Each           e;
+    volatile VALUE list;
+    long           i;
+
+    if (Qnil == value || Qfalse == value) {
+        if (NULL != d->each) {
+            each_free(d->each);
+            d->each = NULL;
+        }
+        return Qnil;
+    }
+    if (Qtrue == value) {
+        value = rb_str_new_cstr("/*");
+    }
+    list = oj_only_list(p, value, "each_element");
+    for (i = 0; i < RARRAY_LEN(list); i++) {
+        VALUE path = rb_ary_entry(list, i);
+
+        if (0 == oj_only_depth(path)) {
+            rb_raise(rb_eArgError, "each_element path %s is not in an array or object", StringValueCStr(path));
+        }
+    }
+    // Only dropped once the new paths are known to be good.
+    if (NULL != d->each) {
+        each_free(d->each);
+        d->each = NULL;
+    }
+    e = OJ_R_ALLOC(struct _each);
+    memset(e, 0, sizeof(struct _each));
+    e->list = list;
+    for (i = 0; i < RARRAY_LEN(list); i++) {
+        oj_only_path(e->paths + i, rb_ary_entry(list, i));
+        e->cnt++;
+    }
+    d->each = e;
+
+    return list;
+}
+
 static void start(ojParser p) {
     Usual d = (Usual)p->ctx;
 
     d->vtail = d->vhead;
     d->ctail = d->chead;
     d->ktail = d->khead;
+    d->atail = d->ahead;
 }
 
 static void dfree(ojParser p) {
@@ -625,7 +1345,23 @@ static void dfree(ojParser p) {
     OJ_R_FREE(d->vhead);
     OJ_R_FREE(d->chead);
     OJ_R_FREE(d->khead);
+    OJ_R_FREE(d->ahead);
+    if (NULL != d->shapes) {
+        OJ_R_FREE(d->shapes);
+    }
+    if (NULL != d->attr_shapes) {
+        OJ_R_FREE(d->attr_shapes);
+    }
     OJ_R_FREE(d->create_id);
+    if (NULL != d->only) {
+        oj_only_free(d->only);
+    }
+    if (NULL != d->structs) {
+        structs_free(d->structs);
+    }
+    if (NULL != d->each) {
+        each_free(d->each);
+    }
     OJ_R_FREE(p->ctx);
     p->ctx = NULL;
 }
@@ -653,11 +1389,30 @@ static void mark(ojParser p) {
     if (Qnil != d->array_class) {
         rb_gc_mark(d->array_class);
     }
+    if (NULL != d->only) {
+        rb_gc_mark(d->only->list);
+    }
+    if (NULL != d->structs) {
+        rb_gc_mark(d->structs->map);
+    }
+    if (NULL != d->each) {
+        rb_gc_mark(d->each->list);
+    }
     for (vp = d->vhead; vp < d->vtail; vp++) {
         if (Qundef != *vp) {
             rb_gc_mark(*vp);
         }
     }
+    if (NULL != d->shapes) {
+        Shape s;
+        long  i;
+
+        for (s = d->shapes; s < d->shapes + SHAPE_SLOTS; s++) {
+            for (i = 0; i < s->cnt; i++) {
+                rb_gc_mark(s->keys[i]);
+            }
+        }
+    }
 }
 
 ///// options /////////////////////////////////////////////////////////////////
@@ -672,6 +1427,18 @@ struct opt {
     VALUE (*func)(ojParser p, VALUE value);
 };
 
+struct _optArgs {
+    struct opt *op;
+    ojParser    p;
+    VALUE       value;
+};
+
+static VALUE protect_opt(VALUE x) {
+    struct _optArgs *args = (struct _optArgs *)x;
+
+    return args->op->func(args->p, args->value);
+}
+
 static VALUE opt_array_class(ojParser p, VALUE value) {
     Usual d = (Usual)p->ctx;
 
@@ -708,6 +1475,8 @@ static VALUE opt_cache_keys(ojParser p, VALUE value) {
 static VALUE opt_cache_keys_set(ojParser p, VALUE value) {
     Usual d = (Usual)p->ctx;
 
+    shapes_clear(d->shapes);
+
     if (Qtrue == value) {
         d->cache_keys = true;
         d->get_key    = cache_key;
@@ -835,15 +1604,7 @@ static VALUE opt_create_id_set(ojParser p, VALUE value) {
         d->create_id                 = NULL;
         d->create_id_len             = 0;
         p->funcs[OBJECT_FUN].add_str = add_str_key;
-        if (Qnil == d->hash_class) {
-            p->funcs[TOP_FUN].close_object    = close_object;
-            p->funcs[ARRAY_FUN].close_object  = close_object;
-            p->funcs[OBJECT_FUN].close_object = close_object;
-        } else {
-            p->funcs[TOP_FUN].close_object    = close_object_class;
-            p->funcs[ARRAY_FUN].close_object  = close_object_class;
-            p->funcs[OBJECT_FUN].close_object = close_object_class;
-        }
+        set_close_object(p);
     } else {
         rb_check_type(value, T_STRING);
         size_t len = RSTRING_LEN(value);
@@ -856,9 +1617,7 @@ static VALUE opt_create_id_set(ojParser p, VALUE value) {
         d->create_id                      = str_dup(RSTRING_PTR(value), len);
         d->create_id_len                  = (uint8_t)len;
         p->funcs[OBJECT_FUN].add_str      = add_str_key_create;
-        p->funcs[TOP_FUN].close_object    = close_object_create;
-        p->funcs[ARRAY_FUN].close_object  = close_object_create;
-        p->funcs[OBJECT_FUN].close_object = close_object_create;
+        set_close_object(p);
         OJ_R_FREE(prev);
     }
     return opt_create_id(p, value);
@@ -957,17 +1716,7 @@ static VALUE opt_hash_class_set(ojParser p, VALUE value) {
         }
     }
     d->hash_class = value;
-    if (NULL == d->create_id) {
-        if (Qnil == value) {
-            p->funcs[TOP_FUN].close_object    = close_object;
-            p->funcs[ARRAY_FUN].close_object  = close_object;
-            p->funcs[OBJECT_FUN].close_object = close_object;
-        } else {
-            p->funcs[TOP_FUN].close_object    = close_object_class;
-            p->funcs[ARRAY_FUN].close_object  = close_object_class;
-            p->funcs[OBJECT_FUN].close_object = close_object_class;
-        }
-    }
+    set_close_object(p);
     return d->hash_class;
 }
 
@@ -1056,6 +1805,8 @@ static VALUE opt_symbol_keys(ojParser p, VALUE value) {
 static VALUE opt_symbol_keys_set(ojParser p, VALUE value) {
     Usual d = (Usual)p->ctx;
 
+    shapes_clear(d->shapes);
+
     if (Qtrue == value) {
         d->sym_cache = cache_create(0, form_sym, true, false);
         cache_set_expunge_rate(d->sym_cache, d->cache_xrate);
@@ -1106,6 +1857,8 @@ static VALUE option(ojParser p, const char *key, VALUE value) {
         {.name = "class_cache=", .func = opt_class_cache_set},
         {.name = "create_id", .func = opt_create_id},
         {.name = "create_id=", .func = opt_create_id_set},
+        {.name = "each_element", .func = opt_each_element},
+        {.name = "each_element=", .func = opt_each_element_set},
         {.name = "decimal", .func = opt_decimal},
         {.name = "decimal=", .func = opt_decimal_set},
         {.name = "hash_class", .func = opt_hash_class},
@@ -1116,6 +1869,10 @@ static VALUE option(ojParser p, const char *key, VALUE value) {
         {.name = "missing_class=", .func = opt_missing_class_set},
         {.name = "omit_null", .func = opt_omit_null},
         {.name = "omit_null=", .func = opt_omit_null_set},
+        {.name = "only", .func = opt_only},
+        {.name = "only=", .func = opt_only_set},
+        {.name = "struct_class", .func = opt_struct_class},
+        {.name = "struct_class=", .func = opt_struct_class_set},
         {.name = "symbol_keys", .func = opt_symbol_keys},
         {.name = "symbol_keys=", .func = opt_symbol_keys_set},
         {.name = "raise_on_empty", .func = opt_raise_on_empty},
@@ -1125,7 +1882,31 @@ static VALUE option(ojParser p, const char *key, VALUE value) {
 
     for (op = opts; NULL != op->name; op++) {
         if (0 == strcmp(key, op->name)) {
-            return op->func(p, value);
+            Usual d = (Usual)p->ctx;
+            VALUE rv;
+
+            struct _optArgs args = {op, p, value};
+            int             ex   = 0;
+
+            if (NULL != d->only) {
+                only_unwrap(p, d->only);
+            }
+            if (NULL != d->each) {
+                each_unwrap(p, d->each);
+            }
+            // Rewrap even when the setter raises or only and each_element
+            // would be silently dropped.
+            rv = rb_protect(protect_opt, (VALUE)&args, &ex);
+            if (NULL != d->each) {
+                each_wrap(p, d->each);
+            }
+            if (NULL != d->only) {
+                only_wrap(p, d->only);
+            }
+            if (0 != ex) {
+                rb_jump_tag(ex);
+            }
+            return rv;
         }
     }
     rb_raise(rb_eArgError, "%s is not an option for the Usual delegate", key);
@@ -1146,6 +1927,10 @@ void oj_init_usual(ojParser p, Usual d) {
     d->kend  = d->khead + cap;
     d->ktail = d->khead;
 
+    d->ahead = OJ_R_ALLOC_N(char, cap);
+    d->aend  = d->ahead + cap;
+    d->atail = d->ahead;
+
     cap      = 256;
     d->chead = OJ_R_ALLOC_N(struct _col, cap);
     d->cend  = d->chead + cap;
@@ -1158,6 +1943,11 @@ void oj_init_usual(ojParser p, Usual d) {
     d->cache_str          = 6;
     d->array_class        = Qnil;
     d->hash_class         = Qnil;
+    d->only               = NULL;
+    d->structs            = NULL;
+    d->each               = NULL;
+    d->shapes             = NULL;
+    d->attr_shapes        = NULL;
     d->create_id          = NULL;
     d->create_id_len      = 0;
     d->miss_class         = MISS_IGNORE;
@@ -1217,6 +2007,10 @@ void oj_init_usual(ojParser p, Usual d) {
     p->mark   = mark;
     p->start  = start;
 
+    // String values are read from p->str so strings without escapes are
+    // made straight from the input instead of a copy of it.
+    p->str_direct = true;
+
     if (0 == to_f_id) {
         to_f_id = rb_intern("to_f");
     }
@@ -5,16 +5,24 @@
 #include <stdint.h>
 
 struct _cache;
+struct _each;
 struct _ojParser;
+struct _only;
+struct _shape;
+struct _structs;
 
 // Used to mark the start of each Hash, Array, or Object. The members point at
 // positions of the start in the value stack and if not an Array into the key
-// stack.
+// stack and the key arena.
 typedef struct _col {
     long vi;  // value stack index
     long ki;  // key stack index if an hash else -1 for an array
+    long ai;  // key arena offset if an hash
 } *Col;
 
+// Keys too long for buf are kept in the key arena. Keys are pushed and popped
+// in stack order so the arena is a stack as well and is reset by start()
+// without being freed.
 typedef union _key {
     struct {
         int16_t len;
@@ -22,7 +30,7 @@ typedef union _key {
     };
     struct {
         int16_t xlen;  // should be the same as len
-        char   *key;
+        size_t  off;   // offset in the key arena
     };
 } *Key;
 
@@ -43,6 +51,10 @@ typedef struct _usual {
     Key ktail;
     Key kend;
 
+    char *ahead;  // key arena
+    char *atail;
+    char *aend;
+
     VALUE (*get_key)(struct _ojParser *p, Key kp);
     struct _cache *key_cache;  // same as str_cache or sym_cache
     struct _cache *str_cache;
@@ -53,6 +65,12 @@ typedef struct _usual {
     VALUE array_class;
     VALUE hash_class;
 
+    struct _only    *only;         // NULL unless the only option is set
+    struct _structs *structs;      // NULL unless the struct_class option is set
+    struct _each    *each;         // NULL unless the each_element option is set
+    struct _shape   *shapes;       // key sets of recent objects, NULL until used
+    struct _shape   *attr_shapes;  // the same for create_id Objects
+
     char   *create_id;
     uint8_t create_id_len;
     uint8_t cache_str;
@@ -43,4 +43,8 @@ void oj_set_parser_validator(ojParser p) {
     p->free   = dfree;
     p->mark   = mark;
     p->start  = noop;
+
+    // Nothing above touches a Ruby object so large documents are validated
+    // without holding the GVL.
+    p->gvl_free = true;
 }
@@ -9,3 +9,6 @@ end
 
 require 'test_parser_usual'
 require 'test_parser_saj'
+require 'test_parser_lines'
+require 'test_parser_tape'
+require 'test_parser_validate'
@@ -0,0 +1,103 @@
+#!/usr/bin/env ruby
+# frozen_string_literal: true
+
+$LOAD_PATH << __dir__
+
+require 'helper'
+require 'stringio'
+
+class LinesTest < Minitest::Test
+
+  def test_string
+    p = Oj::Parser.new(:usual)
+    json = %|{"a":1,"b":[true,null,"x"]}\n\n[1.5,{"c":{}}]\n  \n"str"\n12|
+    assert_equal([{ 'a' => 1, 'b' => [true, nil, 'x'] }, [1.5, { 'c' => {} }], 'str', 12], p.parse_lines(json))
+  end
+
+  def test_block
+    p = Oj::Parser.new(:usual)
+    results = []
+    assert_equal(p, p.parse_lines(%|{"a":1}\n{"b":2}\nnull\n|) { |v| results << v })
+    assert_equal([{ 'a' => 1 }, { 'b' => 2 }, nil], results)
+  end
+
+  def test_threads
+    p = Oj::Parser.new(:usual)
+    json = (0...20_000).map { |i| %|{"i":#{i},"s":"v\\u00e9#{i}","f":#{i}.25,"a":[#{i},{"x":null}]}| }.join("\n")
+    expect = (0...20_000).map { |i| { 'i' => i, 's' => "vé#{i}", 'f' => i + 0.25, 'a' => [i, { 'x' => nil }] } }
+
+    assert_equal(expect, p.parse_lines(json))
+    assert_equal(expect, p.parse_lines(json, threads: 4))
+    assert_equal(expect, p.parse_lines(StringIO.new(json), threads: 3))
+
+    results = []
+    p.parse_lines(StringIO.new(json + "\n"), threads: 2) { |v| results << v }
+    assert_equal(expect, results)
+  end
+
+  def test_error_line
+    p = Oj::Parser.new(:usual)
+    json = ([%|{"a":[1,2,3]}|] * 10_000).join("\n") + %|\n\n{"a":tru}\n[1]\n|
+    error = assert_raises(EncodingError) { p.parse_lines(json, threads: 4) }
+    assert_match(/line 10002/, error.message)
+
+    error = assert_raises(EncodingError) { p.parse_lines(%|[1]\n[1] [2]\n|) }
+    assert_match(/line 2/, error.message)
+  end
+
+  def test_saj
+    handler = Class.new(Oj::Saj) {
+      attr_reader :calls
+      def initialize
+        super
+        @calls = []
+      end
+
+      def hash_start(key)
+        @calls << [:hash_start, key]
+      end
+
+      def add_value(value, key)
+        @calls << [:add_value, value, key]
+      end
+    }.new
+    p = Oj::Parser.new(:saj, handler: handler)
+    p.parse_lines(%|{"a":1}\n"x"\n|)
+    assert_equal([[:hash_start, nil], [:add_value, 1, 'a'], [:add_value, 'x', nil]], handler.calls)
+  end
+
+  # Locations are in the whole input, the same as parse reports.
+  def test_saj_location
+    handler = Class.new(Oj::Saj) {
+      attr_reader :calls
+      def initialize
+        super
+        @calls = []
+      end
+
+      def array_start(key, line, column)
+        @calls << [:array_start, key, line, column]
+      end
+
+      def add_value(value, key, line, column)
+        @calls << [:add_value, value, key, line, column]
+      end
+    }
+    json = %|[1]\n\n  [true, "x"]\n|
+    expect = handler.new
+    Oj::Parser.new(:saj, handler: expect).parse(json)
+    h = handler.new
+    Oj::Parser.new(:saj, handler: h).parse_lines(json)
+    assert_equal(expect.calls, h.calls)
+    assert_equal([:array_start, nil, 3, 3], h.calls[2])
+  end
+
+  def test_break
+    p = Oj::Parser.new(:usual)
+    json = (0...20_000).map { |i| %|[#{i}]| }.join("\n")
+    cnt = 0
+    p.parse_lines(json, threads: 4) { |_| break if 10 < (cnt += 1) }
+    assert_equal(11, cnt)
+    assert_equal([[1]], p.parse_lines('[1]'))
+  end
+end
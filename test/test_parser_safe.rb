@@ -133,6 +133,13 @@ class ParserSafeTest < Minitest::Test
     assert_raises(Oj::Parser::TotalElementsError) { parser.parse(nulls) }
   end
 
+  # A setter that raises must not leave the limits unwrapped.
+  def test_limits_survive_a_rejected_option
+    parser = Oj::Parser.safe(max_depth: 2)
+    assert_raises(ArgumentError) { parser.decimal = :junk }
+    assert_raises(Oj::Parser::DepthError) { parser.parse('[[[[[1]]]]]') }
+  end
+
   # omit_null is reported by looking at the add_null slot, which is one of the
   # slots the limits are applied through.
   def test_omit_null_reports_itself
@@ -238,6 +238,90 @@ class ParserSajTest < Minitest::Test
                  ], handler.calls)
   end
 
+  class BatchSaj
+    attr_reader :batches
+
+    def initialize(events=nil)
+      @batches = []
+      @events = events
+    end
+
+    def batch_events
+      @events || [:hash_start, :hash_end, :array_start, :array_end, :add_value]
+    end
+
+    def add_events(events)
+      @batches << events
+    end
+  end
+
+  def test_batch
+    json = %|{"a":[1,"s",null],"b":{"c":2.5}} [true]|
+    p = Oj::Parser.new(:saj, handler: BatchSaj.new, batch: 4)
+    assert_equal(4, p.batch)
+    p.parse(json)
+    assert_equal([
+                   [:hash_start, nil, nil, :array_start, 'a', nil, :add_value, nil, 1, :add_value, nil, 's'],
+                   [:add_value, nil, nil, :array_end, 'a', nil, :hash_start, 'b', nil, :add_value, 'c', 2.5],
+                   [:hash_end, 'b', nil, :hash_end, nil, nil],
+                   [:array_start, nil, nil, :add_value, nil, true, :array_end, nil, nil],
+                 ], p.handler.batches)
+
+    p.handler = BatchSaj.new([:add_value])
+    p.parse(json)
+    assert_equal([[:add_value, nil, 1, :add_value, nil, 's', :add_value, nil, nil, :add_value, 'c', 2.5], [:add_value, nil, true]], p.handler.batches)
+
+    p.batch = nil
+    handler = AllSaj.new()
+    p.handler = handler
+    p.parse('[true]')
+    assert_equal([[:array_start, nil], [:add_value, true, nil], [:array_end, nil]], handler.calls)
+    assert_raises(ArgumentError) {
+      p.batch = 8
+      p.handler = BatchSaj.new([:nope])
+    }
+  end
+
+  def test_only
+    json = %|{"events":[{"ts":1,"x":[1,{"ts":3}]},{"ts":2}],"meta":{"a":[1],"b":2}} 7|
+    handler = AllSaj.new()
+    p = Oj::Parser.new(:saj, handler: handler, only: ['/events/*/ts', '/meta'])
+    assert_equal(['/events/*/ts', '/meta'], p.only)
+    p.parse(json)
+    assert_equal([
+                   [:add_value, 1, 'ts'],
+                   [:add_value, 2, 'ts'],
+                   [:hash_start, 'meta'],
+                   [:array_start, 'a'],
+                   [:add_value, 1, nil],
+                   [:array_end, 'a'],
+                   [:add_value, 2, 'b'],
+                   [:hash_end, 'meta'],
+                 ], handler.calls)
+
+    p.batch = 10
+    p.handler = BatchSaj.new([:add_value])
+    p.parse(json)
+    assert_equal([[:add_value, 'ts', 1, :add_value, 'ts', 2, :add_value, nil, 1, :add_value, 'b', 2]], p.handler.batches)
+
+    p.batch = nil
+    p.only = nil
+    handler = AllSaj.new()
+    p.handler = handler
+    p.parse('[7]')
+    assert_equal([[:array_start, nil], [:add_value, 7, nil], [:array_end, nil]], handler.calls)
+  end
+
+  def test_only_rejected
+    handler = AllSaj.new()
+    p = Oj::Parser.new(:saj, handler: handler, only: ['/a'])
+    assert_raises(TypeError) { p.only = 5 }
+    assert_raises(ArgumentError) { p.only = ['/a' + ('/b' * 2000)] }
+    assert_equal(['/a'], p.only)
+    p.parse('{"a":1,"b":2}')
+    assert_equal([[:add_value, 1, 'a']], handler.calls)
+  end
+
   def test_io
     handler = AllSaj.new()
     json = %| [true,false]  |
@@ -0,0 +1,94 @@
+#!/usr/bin/env ruby
+# frozen_string_literal: true
+
+$LOAD_PATH << __dir__
+
+require 'helper'
+
+class TapeTest < Minitest::Test
+
+  JSON_DOC = %|{"a":1,"b":[true,null,"x\\u00e9",2.5,{"c":12345678901234567890123}],"d":{"e":"f"},"a2":-3}|
+
+  def test_lookup
+    t = Oj::Parser.tape.parse(JSON_DOC)
+    assert_instance_of(Oj::Tape, t)
+    assert_equal(1, t['a'])
+    assert_equal(-3, t[:a2])
+    assert_instance_of(Oj::Tape, t['b'])
+    assert_equal('xé', t['b'][2])
+    assert_equal(2.5, t['b'][-2])
+    assert_nil(t['b'][5])
+    assert_nil(t['missing'])
+    assert_equal(4, t.size)
+    assert_equal(5, t['b'].size)
+  end
+
+  def test_dig
+    t = Oj::Parser.new(:tape).parse(JSON_DOC)
+    assert_equal('f', t.dig('d', 'e'))
+    assert_equal(BigDecimal('12345678901234567890123'), t.dig(:b, 4, :c))
+    assert_nil(t.dig('x', 'y'))
+    assert_raises(TypeError) { t.dig('a', 'b') }
+  end
+
+  def test_each
+    t = Oj::Parser.tape.parse(JSON_DOC)
+    assert_equal(%w[a b d a2], t.each.map { |k, _| k })
+    assert_equal([true, nil, 'xé', 2.5], t['b'].each.first(4))
+    key, value = t.each.to_a[2]
+    assert_equal('d', key)
+    assert_equal({ 'e' => 'f' }, value.to_ruby)
+  end
+
+  def test_to_ruby
+    assert_equal(Oj::Parser.usual.parse(JSON_DOC), Oj::Parser.tape.parse(JSON_DOC).to_ruby)
+    assert_equal([[1], [2], {}], Oj::Parser.tape.parse('[1] [2] {}').to_ruby)
+    assert_equal(7, Oj::Parser.tape.parse('7').to_ruby)
+    assert_nil(Oj::Parser.tape.parse(''))
+  end
+
+  def test_large
+    p = Oj::Parser.new(:tape)
+    assert(p.gvl_free?)
+    refute(Oj::Parser.tape.gvl_free?)
+    json = Oj.dump((1..5000).map { |i| { "k#{i}" => [i, 'x' * (i % 50), i * 0.5] } }, mode: :strict)
+    t = p.parse(json)
+    first = p.parse('[0]')
+    GC.start
+    assert_equal(Oj::Parser.usual.parse(json), t.to_ruby)
+    assert_equal(2500.0, t.dig(4999, 'k5000', 2))
+    assert_equal([0], first.to_ruby)
+  end
+
+  # The default tape parser is shared so it must not let another thread in
+  # while a document is being parsed.
+  def test_default_threads
+    json = Oj.dump((1..5000).map { |i| { "k#{i}" => [i, 'x' * (i % 50)] } }, mode: :strict)
+    threads = 4.times.map {
+      Thread.new { 10.times.map { Oj::Parser.tape.parse(json).dig(4999, 'k5000', 0) } }
+    }
+    threads.each { |t| assert_equal([5000] * 10, t.value) }
+  end
+
+  # A parser made with new parses large documents without the GVL so another
+  # thread that tries to use it at the same time gets an error instead.
+  def test_shared_threads
+    json = Oj.dump((1..5000).map { |i| { "k#{i}" => [i, 'x' * (i % 50)] } }, mode: :strict)
+    p = Oj::Parser.new(:tape)
+    threads = 4.times.map {
+      Thread.new {
+        20.times.map {
+          begin
+            p.parse(json).dig(4999, 'k5000', 0)
+          rescue RuntimeError => e
+            e.message
+          end
+        }
+      }
+    }
+    threads.each { |t|
+      t.value.each { |v| assert_includes([5000, 'the parser is in use by another thread'], v) }
+    }
+    assert_equal(5000, p.parse(json).dig(4999, 'k5000', 0))
+  end
+end
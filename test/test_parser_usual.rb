@@ -4,6 +4,8 @@
 $LOAD_PATH << __dir__
 
 require 'helper'
+require 'tempfile'
+require 'tmpdir'
 
 class UsualTest < Minitest::Test
 
@@ -115,6 +117,44 @@ class UsualTest < Minitest::Test
     end
   end
 
+  # A long run of white space in a document past a kilobyte starts the
+  # structural index and the short indentation after it stops it again so
+  # these should come out the same as with the older parser, with strings and
+  # white space long enough to cross the index blocks and windows.
+  def test_large
+    doc = {
+      'pad' => ' ' * 5000,
+      'uni' => "é中" * 300,
+      'esc' => "a\"b\\c\n" * 100,
+      'list' => (1..500).map { |i| { 'i' => i, 'f' => i * 1.5, 's' => "str#{i}" * (i % 7) } },
+    }
+    p = Oj::Parser.new(:usual)
+    indented = Oj.dump(doc, mode: :strict, indent: 2)
+    [
+      Oj.dump(doc, mode: :strict),
+      indented,
+      indented.gsub(/^ +/) { |m| "\t \r" * m.size },
+      "\n#{' ' * 300}#{indented}",
+    ].each { |json|
+      assert_equal(doc, p.parse(json))
+    }
+  end
+
+  def test_large_error_location
+    p = Oj::Parser.new(:usual)
+    bad = "\n  [1,\n 2 ,\n\n   x]"
+    small = assert_raises(EncodingError) { p.parse(bad) }
+    big = assert_raises(EncodingError) { p.parse("\n#{' ' * 2000}#{bad}") }
+    assert_equal(small.message.sub(/at 5:(\d+)/) { "at 6:#{$1.to_i + 2001}" }, big.message)
+  end
+
+  def test_indented_error_location
+    p = Oj::Parser.new(:usual)
+    bad = %{{\n#{' ' * 40}"a": [\n\n#{' ' * 20}1,\r\n#{"\t" * 17}x]}}
+    assert_match(/at 5:/, assert_raises(EncodingError) { p.parse(bad) }.message)
+    assert_equal({ 'a' => [1, 2] }, p.parse(bad.sub('x', '2')))
+  end
+
   def test_array
     p = Oj::Parser.new(:usual)
     [
@@ -145,6 +185,45 @@ class UsualTest < Minitest::Test
     }
   end
 
+  def test_long_keys
+    k1 = 'k' * 29
+    k2 = 'l' * 30
+    k3 = 'm' * 5000
+    doc = {k1 => {k2 => [{k3 => 1, 'a' => 2}, {k2 => {k3 => nil}}], k3 => 'x'}, k2 => true}
+    json = Oj.dump(doc, mode: :strict)
+    p = Oj::Parser.new(:usual)
+    assert_equal(doc, p.parse(json))
+    # An error part way through leaves long keys behind and the next parse
+    # has to start over.
+    assert_raises(EncodingError) { p.parse(json[0..-8]) }
+    assert_equal(doc, p.parse(json))
+    p.symbol_keys = true
+    assert_equal(Oj.load(json, mode: :strict, symbol_keys: true), p.parse(json))
+  end
+
+  # Objects with the same keys take their keys from a remembered shape.
+  def test_shapes
+    long = 'k' * 40
+    doc = (1..300).map { |i|
+      case i % 4
+      when 0 then {'id' => i, 'name' => "n#{i}", long => [i]}
+      when 1 then {'id' => i, 'name' => "n#{i}"}
+      when 2 then {'name' => i, 'id' => i}
+      else {"k#{i % 50}" => i, 'x' * 300 => 1, 'y' * 300 => 2}
+      end
+    }
+    json = Oj.dump(doc, mode: :strict)
+    p = Oj::Parser.new(:usual)
+    3.times {
+      assert_equal(doc, p.parse(json))
+      GC.start
+    }
+    p.symbol_keys = true
+    assert_equal(Oj.load(json, mode: :strict, symbol_keys: true), p.parse(json))
+    p.symbol_keys = false
+    assert_equal(doc, p.parse(json))
+  end
+
   def test_symbol_keys
     p = Oj::Parser.new(:usual)
     refute(p.symbol_keys)
@@ -157,6 +236,29 @@ class UsualTest < Minitest::Test
     p = Oj::Parser.new(:usual)
     doc = p.parse('{"ぴ": "", "ぴ ": "x", "c": "ぴーたー", "d": " ぴーたー "}')
     assert_equal({'ぴ' => '', 'ぴ ' => 'x', 'c' => 'ぴーたー', 'd' => ' ぴーたー '}, doc)
+
+    # Strings without escapes are made from the input and the others from
+    # the parser's buffer so alternate between them.
+    long = 'y' * 2000
+    json = %|["#{long}","a\\tb",{"k":"#{long}","e":"\\u00e9#{long}"},"#{long}"]|
+    expect = [long, "a\tb", {'k' => long, 'e' => "\u00e9#{long}"}, long]
+    assert_equal(expect, p.parse(json))
+    assert_equal([expect, expect], p.parse_lines("#{json}\n#{json}\n"))
+    assert_equal(Encoding::UTF_8, p.parse(json.b)[0].encoding)
+  end
+
+  # Moves each of the bytes that stop a string scan across the SIMD lanes.
+  def test_string_stops
+    p = Oj::Parser.new(:usual)
+    ['\\"', '\\\\', '\\n', 'é', '中', '\\u00e9'].each { |special|
+      expect = Oj.load(%|"#{special}"|)
+      70.times { |i|
+        assert_equal(('a' * i) + expect + ('b' * 40), p.parse(%|"#{'a' * i}#{special}#{'b' * 40}"|))
+      }
+    }
+    70.times { |i|
+      assert_raises(EncodingError) { p.parse(%|"#{'a' * i}\u0001#{'b' * 40}"|) }
+    }
   end
 
   def test_capacity
@@ -166,6 +268,53 @@ class UsualTest < Minitest::Test
     assert_equal(5000, p.capacity)
   end
 
+  # Digits are taken eight at a time so lengths around each multiple of eight
+  # and around the switch to BigDecimal are covered.
+  def test_long_numbers
+    p = Oj::Parser.new(:usual)
+    digits = '1234567890123456789012345'
+    (1..digits.size).each { |n|
+      s = digits[0, n]
+      assert_equal(Integer(s), p.parse(s), s)
+      assert_equal(-Integer(s), p.parse("-#{s}"), s)
+      assert_equal([Integer(s)], p.parse("[#{s}]"), s)
+    }
+    {
+      '1.5' => Float,
+      '12345678.12345678' => Float,
+      '0.284685381049155857820172702' => BigDecimal,
+      '-0.77324569633813369' => BigDecimal,
+      '0.00012345678901234567891' => BigDecimal,
+      '-740293790497225751.14052665619933338' => BigDecimal,
+      '-1324122734167910058.834925479' => BigDecimal,
+      '12.345678901234567891e-20' => BigDecimal,
+      '1.5e302' => Float,
+    }.each { |s, clas|
+      v = p.parse(s)
+      assert_instance_of(clas, v, s)
+      assert_equal(Float == clas ? Float(s) : BigDecimal(s), v, s)
+    }
+  end
+
+  # Each of these was off by one ULP when scaled with long doubles.
+  def test_float_rounding
+    p = Oj::Parser.new(:usual)
+    %w[908.4772952e-239 3595947768.7e280 -2.38e-186 4919.65665e-21 -341977609310.930e23 2.225073858507e-308 4.9e-324 1.797693134862e308].each { |s|
+      assert(Float(s).eql?(p.parse(s)), s)
+    }
+    # More than 255 fraction digits, long runs of leading zeros included.
+    ["0.#{'0' * 300}1", "-0.#{'0' * 290}25e-3"].each { |s|
+      assert(Float(s).eql?(p.parse(s)), s)
+    }
+    ["0.#{'0' * 300}12345678901234567890123", "1.#{'0' * 300}1"].each { |s|
+      assert_equal(BigDecimal(s), p.parse(s), s)
+    }
+    assert_equal(-0.0, p.parse('-0.0'))
+    assert((1.0 / p.parse('-0.0')).negative?)
+    assert_equal(Float::INFINITY, p.parse('1.0e400'))
+    assert_equal(0.0, p.parse('1.0e-400'))
+  end
+
   def test_decimal
     p = Oj::Parser.new(:usual)
     assert_equal(:auto, p.decimal)
@@ -199,6 +348,8 @@ class UsualTest < Minitest::Test
     out = []
     p.parse('{"a":1}{"b":{"x":2}} {"c":3}') { |j| out.push(j) }
     assert_equal([{'a'=>1}, {'b'=>{'x'=>2}},{'c'=>3}], out)
+
+    assert_equal([12, [1], 3], p.parse("12 [1]\n3"))
   end
 
   def test_multi_load
@@ -218,6 +369,85 @@ class UsualTest < Minitest::Test
     assert_equal([{'a'=>1}, {'b'=>{'x'=>2}},{'c'=>3}], out)
   end
 
+  def test_feed
+    p = Oj::Parser.new(:usual)
+    out = []
+    ['{"a":', '[1,2]}12', '3 "x', '" tr', 'ue [{}] -4.', '5'].each { |chunk|
+      p.feed(chunk) { |v| out.push(v) }
+    }
+    assert_equal([{'a'=>[1, 2]}, 123, 'x', true, [{}]], out)
+    # The last number is only complete at the end of the stream.
+    assert_equal([-4.5], p.finish)
+
+    assert_equal([], p.feed('[1,'))
+    assert_equal([[1, 2]], p.feed('2] '))
+    assert_equal([], p.finish)
+
+    p.feed('{"a":[')
+    assert_raises(EncodingError) { p.finish }
+    # A new stream starts after an error.
+    assert_equal([{'b'=>nil}], p.feed('{"b":null}'))
+    assert_equal([], p.finish)
+  end
+
+  def test_load_io
+    json = Oj.dump((1..5000).map { |i| { "k#{i}" => [i, 'x' * (i % 50)] } }, mode: :strict)
+    expect = Oj::Parser.usual.parse(json)
+    p = Oj::Parser.new(:usual)
+    Tempfile.create('oj_load') { |f|
+      f.write(json)
+      f.flush
+      f.rewind
+      assert_equal(expect, p.load(f))
+
+      # Bytes already buffered by the IO must not be lost.
+      f.rewind
+      f.ungetc(f.getc)
+      assert_equal(expect, p.load(f))
+    }
+    r, w = IO.pipe
+    w.write('{"a":[1,2')
+    w.close
+    assert_raises(EncodingError) { p.load(r) }
+    r.close
+  end
+
+  def test_file
+    p = Oj::Parser.new(:usual)
+    Tempfile.create(['oj_file', '.json']) { |f|
+      # A file that ends exactly on a page boundary has no slack after the
+      # content for a terminator.
+      json = %|{"a":[1,2.5,"#{'x' * 4080}"]}|
+      assert_equal(4096, json.size)
+      f.write(json)
+      f.flush
+      assert_equal({'a'=>[1, 2.5, 'x' * 4080]}, p.file(f.path))
+
+      f.truncate(0)
+      f.rewind
+      f.write('[1,{"b":')
+      f.flush
+      assert_raises(EncodingError) { p.file(f.path) }
+
+      f.truncate(0)
+      assert_nil(p.file(f.path))
+    }
+    return unless Process.respond_to?(:fork)
+
+    Dir.mktmpdir { |dir|
+      path = File.join(dir, 'fifo')
+      File.mkfifo(path)
+      # Opening a FIFO blocks until both ends are open so the writer has to
+      # be another process.
+      pid = fork {
+        File.write(path, '{"a":[1,2,3]}')
+        exit!(0)
+      }
+      assert_equal({'a'=>[1, 2, 3]}, p.file(path))
+      Process.wait(pid)
+    }
+  end
+
   def test_omit_null
     p = Oj::Parser.new(:usual)
     p.omit_null = true
@@ -229,6 +459,106 @@ class UsualTest < Minitest::Test
     assert_equal({'a'=>true, 'b'=>nil}, doc)
   end
 
+  def test_only
+    json = %|{"data":[{"id":1,"x":{"y":[1,"a]}\\"["]}},{"id":2,"z":null}],"meta":{"cursor":"c1","n":3},"a/b":[[{}]]}|
+    p = Oj::Parser.new(:usual, only: ['/data/*/id', '/meta/cursor'])
+    assert_equal(['/data/*/id', '/meta/cursor'], p.only)
+    assert_equal({'data'=>[{'id'=>1}, {'id'=>2}], 'meta'=>{'cursor'=>'c1'}}, p.parse(json))
+    assert_equal({'data'=>[{'id'=>1}, {'id'=>2}], 'meta'=>{'cursor'=>'c1'}}, p.load(StringIO.new(json)))
+
+    p.only = ['/data/1', '/a~1b/0']
+    p.omit_null = true
+    assert_equal({'data'=>[{'id'=>2}], 'a/b'=>[[{}]]}, p.parse(json))
+
+    p.only = nil
+    p.omit_null = false
+    assert_equal(Oj::Parser.usual.parse(json), p.parse(json))
+
+    p.only = '/meta'
+    assert_raises(EncodingError) { p.parse('{"data":[1,{"x":2}') }
+  end
+
+  # Paths are RFC 6901 JSON Pointers so "/" is the empty key, not the root.
+  def test_only_pointers
+    json = '{"":{"x":1,"y":2},"a":3}'
+    assert_equal({'' => {'x' => 1, 'y' => 2}}, Oj::Parser.new(:usual, only: ['/']).parse(json))
+    assert_equal({'' => {'x' => 1}}, Oj::Parser.new(:usual, only: '//x').parse(json))
+    assert_equal(Oj::Parser.usual.parse(json), Oj::Parser.new(:usual, only: '').parse(json))
+    assert_raises(ArgumentError) { Oj::Parser.new(:usual, only: ['a']) }
+    assert_raises(ArgumentError) { Oj::Parser.new(:usual, each_element: 'a/*') }
+    assert_raises(ArgumentError) { Oj::Parser.new(:usual, struct_class: {'a' => Item}) }
+    assert_raises(ArgumentError) { Oj::Parser.new(:saj, only: ['a']) }
+  end
+
+  def test_only_survives_a_rejected_option
+    json = '{"items":[1,2],"x":3}'
+    p = Oj::Parser.new(:usual, only: ['/items'])
+    assert_raises(ArgumentError) { p.struct_class = {'/x' => String} }
+    assert_raises(ArgumentError) { p.each_element = '' }
+    assert_raises(TypeError) { p.only = 5 }
+    assert_equal(['/items'], p.only)
+    assert_equal({'items' => [1, 2]}, p.parse(json))
+  end
+
+  Item = Struct.new(:id, :name, :tags)
+
+  def test_struct_class
+    json = %|{"items":[{"id":1,"name":"a","tags":[1]},{"name":"b","x":{"id":3},"id":2}],"first":{"id":4}}|
+    p = Oj::Parser.new(:usual, struct_class: {'/items/*' => Item, '/first' => Item})
+    assert_equal({'/items/*' => Item, '/first' => Item}, p.struct_class)
+    assert_equal({'items' => [Item.new(1, 'a', [1]), Item.new(2, 'b', nil)], 'first' => Item.new(4)}, p.parse(json))
+
+    p.struct_class = {'/items/1/x' => Item, '' => Item}
+    p.hash_class = MyHash
+    doc = p.parse(json)
+    assert_equal(Item, doc.class)
+    assert_nil(doc.id)
+    p.struct_class = {'/name/x' => Item, '' => Item}
+    doc = p.parse('{"id":{"a":1},"name":{"x":{"id":3}}}')
+    assert_equal(MyHash, doc.id.class)
+    assert_equal(Item.new(3), doc.name['x'])
+    docs = []
+    p.parse('{"id":5} {"id":6}') { |d| docs << d }
+    assert_equal([Item.new(5), Item.new(6)], docs)
+
+    if defined?(Data) && Data.respond_to?(:define)
+      point = Data.define(:x, :y)
+      p.struct_class = {'/*' => point}
+      assert_equal([point.new(x: 1, y: 2), point.new(x: 3, y: nil)], p.parse('[{"y":2,"x":1},{"x":3}]'))
+    end
+
+    p.struct_class = {'/*' => Item}
+    assert_raises(ArgumentError) { p.struct_class = {'/a' => String} }
+    assert_raises(ArgumentError) { p.struct_class = {'/a' => Struct.new(:a, keyword_init: true)} }
+    assert_equal({'/*' => Item}, p.struct_class)
+    assert_equal([Item.new(1)], p.parse('[{"id":1}]'))
+    p.struct_class = nil
+    p.hash_class = nil
+    assert_equal(Oj::Parser.usual.parse(json), p.parse(json))
+  end
+
+  def test_each_element
+    json = %|[1,{"a":[2]},"s",[3,4],null]|
+    p = Oj::Parser.new(:usual, each_element: true)
+    assert_equal(['/*'], p.each_element)
+    got = []
+    assert_equal([], p.parse(json) { |v| got << v })
+    assert_equal([1, {'a' => [2]}, 's', [3, 4], nil], got)
+    assert_equal(Oj::Parser.usual.parse(json), p.parse(json))
+
+    got = []
+    long = 'k' * 40
+    p.each_element = ['/data/*', '/meta']
+    p.omit_null = true
+    p.load(StringIO.new(%|{"data":[{"id":1,"#{long}":2},{"id":null}],"x":3,"meta":{"n":1},"#{long}":4}|)) { |v| got << v }
+    assert_equal([{'id' => 1, long => 2}, {}, {'n' => 1}, {'data' => [], 'x' => 3, long => 4}], got)
+
+    assert_raises(ArgumentError) { p.each_element = '' }
+    assert_equal(['/data/*', '/meta'], p.each_element)
+    p.each_element = nil
+    assert_nil(p.each_element)
+  end
+
   class MyArray < Array
   end
 
@@ -301,6 +631,14 @@ class UsualTest < Minitest::Test
     p.create_id = 'class'
     doc = p.parse('{"a":true,"class":"UsualTest::MyClass","b":false}')
     assert_equal('UsualTest::MyClass{a: true b: false}', doc.to_s)
+
+    # Repeated attribute sets are taken from a remembered shape.
+    p.hash_class = nil
+    docs = p.parse('[' + (1..40).map { |i|
+      i.odd? ? %|{"class":"UsualTest::MyClass","a":#{i},"b":"x"}| : %|{"b":#{i},"class":"UsualTest::MyClass","a":"y"}|
+    }.join(',') + ']')
+    assert_equal('UsualTest::MyClass{a: 39 b: x}', docs[38].to_s)
+    assert_equal('UsualTest::MyClass{a: y b: 40}', docs[39].to_s)
   end
 
   # The delegate keeps its own copy of create_id, and setting it again replaced
@@ -347,6 +685,19 @@ class UsualTest < Minitest::Test
     assert_equal(Auto2, doc.class)
   end
 
+  # Expunged entries are taken out of the middle of probe runs in the cache
+  # so the entries after them have to be found again.
+  def test_cache_expunge
+    p = Oj::Parser.new(:usual, cache_expunge: 3, cache_strings: 30)
+    4.times { |r|
+      doc = (0...3000).to_h { |i| ["k#{(i * r) % 3000}", "v#{i % 700}"] }
+      json = Oj.dump(doc, mode: :strict)
+      assert_equal(doc, p.parse(json))
+      GC.start
+      assert_equal(doc, p.parse(json))
+    }
+  end
+
   def test_default_parser
     doc = Oj::Parser.usual.parse('{"a":true,"b":null}')
     assert_equal({'a'=>true, 'b'=>nil}, doc)
@@ -0,0 +1,49 @@
+#!/usr/bin/env ruby
+# frozen_string_literal: true
+
+$LOAD_PATH << __dir__
+
+require 'helper'
+
+class ValidateTest < Minitest::Test
+
+  def test_gvl_free
+    refute(Oj::Parser.validate.gvl_free?)
+    assert(Oj::Parser.new(:validate).gvl_free?)
+    refute(Oj::Parser.usual.gvl_free?)
+    refute(Oj::Parser.new(:saj).gvl_free?)
+  end
+
+  def test_small
+    p = Oj::Parser.new(:validate)
+    assert_nil(p.parse('{"a":[1,2.5,"x",null,true,false]}'))
+    assert_raises(EncodingError) { p.parse('[1,2') }
+  end
+
+  # Documents this large are validated with the GVL released.
+  def test_large
+    json = Oj.dump((1..5000).map { |i| { "k#{i}" => [i, i * 1.5, 'x' * (i % 50), nil, true] } }, mode: :strict)
+    p = Oj::Parser.new(:validate)
+    assert_nil(p.parse(json))
+
+    error = assert_raises(EncodingError) { p.parse(json[0..-2]) }
+    assert_match(/Array is not closed/, error.message)
+
+    error = assert_raises(EncodingError) { p.parse(json.sub('"k77"', '"k77" x')) }
+    assert_match(/unexpected character/, error.message)
+  end
+
+  def test_large_threads
+    json = Oj.dump((1..5000).map { |i| { "k#{i}" => [i, 'x' * (i % 50)] } }, mode: :strict)
+    bad = json.sub('"k4999"', '"k4999" x')
+    threads = 4.times.map { |i|
+      Thread.new {
+        p = i < 2 ? Oj::Parser.validate : Oj::Parser.new(:validate)
+        10.times.map { (i.even? ? p.parse(json) : p.parse(bad)) rescue :error }
+      }
+    }
+    threads.each_with_index { |t, i|
+      assert_equal([i.even? ? nil : :error] * 10, t.value)
+    }
+  end
+end
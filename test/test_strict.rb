@@ -70,6 +70,17 @@ class StrictJuice < Minitest::Test
     dump_and_load(-2.48e100 * 1.0e10, false)
   end
 
+  def test_float_rounding
+    %w[908.4772952e-239 -2.38e-186 4919.65665e-21 0.1e-5 2.225073858507e-308 4.9e-324 1.797693134862e308].each { |s|
+      assert(Float(s).eql?(Oj.load(s, mode: :strict)), s)
+      assert(Float(s).eql?(Oj.load(s, mode: :strict, bigdecimal_load: :fast)), s)
+    }
+    # Too many digits for the fast conversion so these take the slow path.
+    %w[6.2705324864590887922 -0.12345678901234567891234 12345678901234567890.5e-300].each { |s|
+      assert(Float(s).eql?(Oj.load(s, mode: :strict, bigdecimal_load: :fast)), s)
+    }
+  end
+
   def test_invalid_float
     begin
       Oj.load("64ecb72d29191067f91ff95b")
@@ -123,6 +134,33 @@ class StrictJuice < Minitest::Test
     dump_and_load("a\u0041", false)
   end
 
+  def test_string_escape_positions
+    # Puts each character that needs an escape at every position of strings
+    # that cover the full and partial widths of the vector scanners.
+    ["\"", '\\', '/', "\n", "\t", "\u0001", "\u000b"].each { |c|
+      [31, 32, 64, 65, 130].each { |len|
+        (0...len).each { |i|
+          str = 'x' * len
+          str[i] = c
+          json = Oj.dump(str, mode: :strict)
+          assert_equal(str, Oj.strict_load(json))
+          assert_equal(str, Oj.strict_load(StringIO.new(json)))
+          assert_equal(str, Oj.load(Oj.dump(str, mode: :compat, escape_mode: :slash), mode: :compat))
+        }
+      }
+    }
+  end
+
+  def test_escape_runs
+    # Back to back escapes and surrogate pairs long enough to grow the
+    # unescape buffer.
+    str = %{"\\/\n\t\b\f\r\u0001ab\u00e9\u{1F600}} * 200
+    json = Oj.dump(str, mode: :strict)
+    assert_equal(str, Oj.strict_load(json))
+    assert_equal(str, Oj.strict_load(StringIO.new(json)))
+    assert_equal(%{\u{1F600}\u00e9"} * 300, Oj.strict_load(%{"#{'\\ud83d\\ude00\\u00e9\\"' * 300}"}))
+  end
+
   def test_encode
     opts = Oj.default_options
     Oj.default_options = { :ascii_only => false }
@@ -207,6 +245,17 @@ class StrictJuice < Minitest::Test
     assert_equal({"a\nb" => true, "c\td" => false}, obj)
   end
 
+  # The key cache is shared by threads and grows while they read from it.
+  def test_hash_keys_from_threads
+    docs = (0...4).map { |t| (0...3000).to_h { |i| ["t#{t}k#{i}", i] } }
+    threads = docs.map { |doc|
+      json = Oj.dump(doc, mode: :strict)
+      Thread.new { 5.times.map { Oj.strict_load(json) == doc }.all? }
+    }
+    GC.start
+    threads.each { |t| assert(t.value) }
+  end
+
   def test_non_str_hash
     begin
       Oj.dump({ 1 => true, 0 => false })